@@ -38,67 +38,108 @@ public:
         return value;
     }
 
+    //
+    // Constructors take the call site as default arguments. Operators
+    // cannot, assignments are attributed to the enclosing TRACKER_CALL
+    // or scope
+    //
+
     #define ENTER_CTOR(type, other) \
-    Tracker::mainLogger.setName(info, name); \
-    info.value = std::to_string(value); \
+    TRACKER_DISPATCHER.setName(info, name, Tracker::trackedTypeId<Int>()); \
+    info.site = TRACKER_DISPATCHER.callSite(site); \
+    info.value = Tracker::capture(value); \
     info.address = this; \
-    Tracker::mainLogger.setHistory(Tracker::ModificationType::type, info, other);
+    TRACKER_DISPATCHER.setHistory(Tracker::ModificationType::type, info, other);
+
+    #define ADOPT(object) \
+    if (TRACKER_DISPATCHER.adopt((object).info, &(object), Tracker::trackedTypeId<Int>())) \
+        (object).info.value = Tracker::capture((object).value);
 
     #define ENTER_ASG(type, other) \
-    info.value = std::to_string(value); \
-    Tracker::mainLogger.setHistory(Tracker::ModificationType::type, info, other);
+    ADOPT(*this) \
+    info.site = TRACKER_DISPATCHER.callSite(); \
+    info.value = Tracker::capture(value); \
+    TRACKER_DISPATCHER.setHistory(Tracker::ModificationType::type, info, other);
 
-    // Constructors
-    Int(int value = 0, std::string name = "") : 
+    // Constructors, named at every level
+    Int(int value = 0, char const* name = "", TRACKER_SITE) : 
         value(value)
     {
-        ENTER_CTOR(CTOR, nullptr)
-        Tracker::mainLogger.enterCTOR(info);
+        TRACKER_IF(COPIES)
+        {
+            ENTER_CTOR(CTOR, nullptr)
+            TRACKER_AT(LIFETIMES)
+                TRACKER_DISPATCHER.enterCTOR(info);
+        }
     }
 
-    Int(Int const& a, std::string name = "") : 
+    Int(Int const& a, char const* name = "", TRACKER_SITE) : 
         value(a.value)
     {
-        ENTER_CTOR(CTORCopy, &a.info)
-        Tracker::mainLogger.enterCTORCopy(info, a.info);
+        TRACKER_IF(COPIES)
+        {
+            ADOPT(a)
+            ENTER_CTOR(CTORCopy, &a.info)
+            TRACKER_DISPATCHER.enterCTORCopy(info, a.info);
+        }
     }
 #ifndef INT_NO_MOVE
-    Int(Int&& a, std::string name = "") :
+    Int(Int&& a, char const* name = "", TRACKER_SITE) :
         value(a.value)
     {
-        ENTER_CTOR(CTORMove, &a.info)
-        Tracker::mainLogger.enterCTORMove(info, a.info);
+        TRACKER_IF(COPIES)
+        {
+            ADOPT(a)
+            ENTER_CTOR(CTORMove, &a.info)
+            TRACKER_DISPATCHER.enterCTORMove(info, a.info);
+        }
     }
 #endif
 
     Int& operator=(int a)
     {
         value = a;
-        ENTER_ASG(Asg, nullptr)
-        Tracker::mainLogger.enterAsg(info);
+        TRACKER_IF(ASSIGNMENTS)
+        {
+            ENTER_ASG(Asg, nullptr)
+            TRACKER_DISPATCHER.enterAsg(info);
+        }
         return *this;
     }
 
     Int& operator=(Int const& a)
     {
         value = a.value;
-        ENTER_ASG(AsgCopy, &a.info)
-        Tracker::mainLogger.enterAsgCopy(info, a.info);
+        TRACKER_IF(COPIES)
+        {
+            ADOPT(a)
+            ENTER_ASG(AsgCopy, &a.info)
+            TRACKER_DISPATCHER.enterAsgCopy(info, a.info);
+        }
         return *this;
     }
 #ifndef INT_NO_MOVE
     Int& operator=(Int&& a)
     {
         value = a.value;
-        ENTER_ASG(AsgMove, &a.info)
-        Tracker::mainLogger.enterAsgMove(info, a.info);
+        TRACKER_IF(COPIES)
+        {
+            ADOPT(a)
+            ENTER_ASG(AsgMove, &a.info)
+            TRACKER_DISPATCHER.enterAsgMove(info, a.info);
+        }
         return *this;
     }
 #endif
 
+    // Objects created while tracking was off and never modified have no id
     ~Int()
     {
-        Tracker::mainLogger.enterDTOR(info);
+        TRACKER_IF(LIFETIMES)
+        {
+            if (info.id >= 0)
+                TRACKER_DISPATCHER.enterDTOR(info);
+        }
     }
 
     // Arithmetics
@@ -106,9 +147,15 @@ public:
     Int& operator name##=(Int const& b) \
     { \
         value name##= b.value; \
-        info.value = std::to_string(value); \
-        Tracker::mainLogger.setHistory(Tracker::ModificationType::AsgOper, info, &b.info, #name); \
-        Tracker::mainLogger.enterAsgOper(info, b.info, #name); \
+        TRACKER_IF(ASSIGNMENTS) \
+        { \
+            ADOPT(*this) \
+            ADOPT(b) \
+            info.site = TRACKER_DISPATCHER.callSite(); \
+            info.value = Tracker::capture(value); \
+            TRACKER_DISPATCHER.setHistory(Tracker::ModificationType::AsgOper, info, &b.info, #name); \
+            TRACKER_DISPATCHER.enterAsgOper(info, b.info, #name); \
+        } \
         return *this; \
     } \
     const Int operator name(Int const& b) const \
@@ -211,5 +258,5 @@ public:
 
 protected:
     int value;
-    Tracker::TrackedInfo info;
+    mutable Tracker::TrackedInfo info; // sources made while tracking was off are named when used
 };
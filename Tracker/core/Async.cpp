@@ -0,0 +1,323 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Async.cpp
+
+Abstract:
+
+    Asynchronous capture: events are written into per-thread
+    rings of fixed-size records and drained by a background thread.
+
+Author / Creation date:
+
+    JulesIMF / 12.03.22
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <Tracker.h>
+#include <Record.h>
+#include <Colors.h>
+#include <chrono>
+
+//
+// Defines
+//
+
+namespace Tracker
+{
+    AsyncLogger::AsyncLogger(Logger* target, std::size_t capacity) :
+        target(target)
+    {
+        std::size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+
+        mask = size - 1;
+        drain = std::thread(&AsyncLogger::drainLoop, this);
+    }
+
+    AsyncLogger::~AsyncLogger()
+    {
+        isRunning.store(false, std::memory_order_release);
+        drain.join();
+
+        std::size_t total = 0;
+        producers.forEach([&](Producer const& producer)
+        {
+            total += producer.tail.load();
+        });
+
+        fprintf(stderr, "%sAsyncLogger: %s%zu events queued, %zu dropped\n",
+                TerminalColor::PurpleB, TerminalColor::Default,
+                total, dropped());
+
+        delete target;
+    }
+
+    void AsyncLogger::attach(MainLoggerBase const* owner)
+    {
+        Logger::attach(owner);
+        target->attach(owner);
+    }
+
+    std::size_t AsyncLogger::queued() const
+    {
+        std::size_t total = 0;
+        producers.forEach([&](Producer const& producer)
+        {
+            total += producer.tail.load(std::memory_order_acquire) - producer.head.load(std::memory_order_acquire);
+        });
+
+        return total;
+    }
+
+    std::size_t AsyncLogger::dropped() const
+    {
+        return nDropped.load(std::memory_order_relaxed);
+    }
+
+    //
+    // The ring is allocated by its thread before the first commit,
+    // the drain thread reads it only once tail says there is a record
+    //
+
+    AsyncLogger::Producer& AsyncLogger::producer()
+    {
+        auto& producer = producers.local();
+        if (producer.ring.empty())
+            producer.ring.resize(mask + 1);
+
+        return producer;
+    }
+
+    EventRecord* AsyncLogger::reserve(Producer& producer, EventRecord::Kind kind)
+    {
+        auto position = producer.tail.load(std::memory_order_relaxed);
+        if (position - producer.head.load(std::memory_order_acquire) > mask)
+            return nullptr;
+
+        auto slot = &producer.ring[position & mask];
+        slot->kind = kind;
+        slot->time = eventTime();
+        return slot;
+    }
+
+    void AsyncLogger::commit(Producer& producer)
+    {
+        producer.tail.store(producer.tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    void AsyncLogger::record(EventRecord::Kind kind, TrackedInfo const& infoTo, TrackedInfo const* infoFrom)
+    {
+        auto& producer = this->producer();
+        auto slot = reserve(producer, kind);
+        if (slot == nullptr)
+        {
+            nDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        encode(slot->to, infoTo);
+        if (infoFrom)
+            encode(slot->from, *infoFrom);
+
+        commit(producer);
+    }
+
+    void AsyncLogger::enterFunction(int function)
+    {
+        auto& producer = this->producer();
+        auto slot = reserve(producer, EventRecord::Kind::Function);
+        producer.scopeKept.push_back(slot != nullptr);
+        if (slot == nullptr)
+        {
+            nDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        slot->function = function;
+        commit(producer);
+    }
+
+    void AsyncLogger::exitFunction()
+    {
+        auto& producer = this->producer();
+        bool isKept = producer.scopeKept.back();
+        producer.scopeKept.pop_back();
+        if (!isKept)
+            return;
+
+        //
+        // Scope exits are never dropped, otherwise
+        // the target's call stack goes out of balance
+        //
+
+        while (reserve(producer, EventRecord::Kind::ExitFunction) == nullptr)
+            std::this_thread::yield();
+
+        commit(producer);
+    }
+
+    void AsyncLogger::enterDTOR(TrackedInfo const& info)
+    {
+        record(EventRecord::Kind::DTOR, info);
+    }
+
+    void AsyncLogger::enterCTOR(TrackedInfo const& info)
+    {
+        record(EventRecord::Kind::CTOR, info);
+    }
+
+    void AsyncLogger::enterCTORCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+    {
+        record(EventRecord::Kind::CTORCopy, infoTo, &infoFrom);
+    }
+
+    void AsyncLogger::enterCTORMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+    {
+        record(EventRecord::Kind::CTORMove, infoTo, &infoFrom);
+    }
+
+    void AsyncLogger::enterAsg(TrackedInfo const& info)
+    {
+        record(EventRecord::Kind::Asg, info);
+    }
+
+    void AsyncLogger::enterAsgCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+    {
+        record(EventRecord::Kind::AsgCopy, infoTo, &infoFrom);
+    }
+
+    void AsyncLogger::enterAsgMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+    {
+        record(EventRecord::Kind::AsgMove, infoTo, &infoFrom);
+    }
+
+    void AsyncLogger::enterAsgOper(TrackedInfo const& infoTo, TrackedInfo const& infoFrom, std::string const& oper)
+    {
+        auto& producer = this->producer();
+        auto slot = reserve(producer, EventRecord::Kind::AsgOper);
+        if (slot == nullptr)
+        {
+            nDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        encodeOper(*slot, oper);
+        encode(slot->to, infoTo);
+        encode(slot->from, infoFrom);
+        commit(producer);
+    }
+
+    void AsyncLogger::enterAlloc(AllocInfo const& info)
+    {
+        auto& producer = this->producer();
+        if (info.kind != AllocInfo::Kind::Realloc)
+        {
+            auto slot = reserve(producer, EventRecord::Kind::Alloc);
+            if (slot == nullptr)
+            {
+                nDropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            slot->alloc = info;
+            commit(producer);
+            return;
+        }
+
+        //
+        // Windows are kept like scopes: their exits are never dropped
+        //
+
+        auto slot = reserve(producer, EventRecord::Kind::Alloc);
+        producer.scopeKept.push_back(slot != nullptr);
+        if (slot == nullptr)
+        {
+            nDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        slot->alloc = info;
+        commit(producer);
+    }
+
+    void AsyncLogger::exitAlloc(AllocInfo const& info)
+    {
+        auto& producer = this->producer();
+        bool isKept = producer.scopeKept.back();
+        producer.scopeKept.pop_back();
+        if (!isKept)
+            return;
+
+        EventRecord* slot;
+        while ((slot = reserve(producer, EventRecord::Kind::ExitAlloc)) == nullptr)
+            std::this_thread::yield();
+
+        slot->alloc = info;
+        commit(producer);
+    }
+
+    void AsyncLogger::drainLoop()
+    {
+        //
+        // Lane 0 is not announced: a single thread is logged as
+        // it would be without the rings. Rings are replayed out of
+        // the lock of producers, new threads are not held up.
+        //
+
+        std::vector<Producer*> pending;
+        int lane = 0;
+
+        while (true)
+        {
+            bool isStopping = !isRunning.load(std::memory_order_acquire);
+            bool isIdle = true;
+
+            pending.clear();
+            producers.forEach([&](Producer& producer)
+            {
+                pending.push_back(&producer);
+            });
+
+            for (auto producer : pending)
+            {
+                auto position = producer->head.load(std::memory_order_relaxed);
+                auto end = producer->tail.load(std::memory_order_acquire);
+                if (position == end)
+                    continue;
+
+                isIdle = false;
+                if (producer->lane != lane)
+                {
+                    lane = producer->lane;
+                    target->enterLane(lane);
+                }
+
+                ScopeStack::current = &producer->calls;
+                for (; position != end; position++)
+                    replay(*target, producer->ring[position & mask]);
+
+                producer->head.store(position, std::memory_order_release);
+            }
+
+            if (!isIdle)
+                continue;
+
+            if (isStopping)
+                break;
+
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+}
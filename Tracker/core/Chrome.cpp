@@ -0,0 +1,349 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Chrome.cpp
+
+Abstract:
+
+    Chrome trace event JSON, in the array format: a file cut
+    short by a crash is still read, the closing bracket is
+    optional. Times are in microseconds with nanosecond fractions.
+
+Author / Creation date:
+
+    JulesIMF / 02.04.22
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <Tracker.h>
+#include <charconv>
+#include <stdexcept>
+
+//
+// Defines
+//
+
+namespace Tracker
+{
+    static int const pid = 1;
+    static std::uint64_t const noStart = std::uint64_t(-1);
+    static std::uint64_t const instant = 1; // ns, the "dur" of object slices: flows bind to slices that contain them
+
+    ChromeTraceLogger::ChromeTraceLogger(char const* filename)
+    {
+        file = fopen(filename, "w");
+        if (file == nullptr)
+            throw std::runtime_error(std::string("cant open \"") + filename + "\"");
+
+        buffer.reserve(bufferSize + 4096);
+        buffer += "[\n";
+
+        open('M', 0, 0);
+        field("name", "process_name");
+        buffer += ",\"args\":{";
+        buffer += "\"name\":\"tracker\"}";
+        close();
+    }
+
+    ChromeTraceLogger::~ChromeTraceLogger()
+    {
+        //
+        // Objects still alive live up to the end of the trace
+        //
+
+        auto time = now();
+        for (auto const& birth : births)
+        {
+            open('e', time, birth.second.lane);
+            field("cat", "lifetime");
+            buffer += ",\"id\":";
+            number(birth.first);
+            close();
+        }
+
+        buffer += "\n]\n";
+        flush();
+        fclose(file);
+    }
+
+    void ChromeTraceLogger::flush()
+    {
+        fwrite(buffer.data(), 1, buffer.size(), file);
+        buffer.clear();
+    }
+
+    //
+    // The trace starts at its first event: replayed events keep
+    // the times of the process that made them
+    //
+
+    std::uint64_t ChromeTraceLogger::now()
+    {
+        auto time = eventTime();
+        if (start == noStart)
+            start = time;
+
+        return time < start ? 0 : time - start;
+    }
+
+    void ChromeTraceLogger::number(long long value)
+    {
+        char digits[24];
+        auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+        buffer.append(digits, end);
+    }
+
+    void ChromeTraceLogger::open(char phase, std::uint64_t time, int tid)
+    {
+        //
+        // Formatted by hand, snprintf is most of the cost of an event
+        //
+
+        char fraction[] = { '.', char('0' + time / 100 % 10), char('0' + time / 10 % 10), char('0' + time % 10) };
+
+        buffer += isFirst ? "{\"ph\":\"" : ",\n{\"ph\":\"";
+        buffer += phase;
+        buffer += "\",\"pid\":";
+        number(pid);
+        buffer += ",\"tid\":";
+        number(tid);
+        buffer += ",\"ts\":";
+        number(time / 1000);
+        buffer.append(fraction, sizeof(fraction));
+        isFirst = false;
+    }
+
+    void ChromeTraceLogger::field(char const* key, std::string const& value)
+    {
+        buffer += ",\"";
+        buffer += key;
+        buffer += "\":\"";
+
+        //
+        // Runs without quotes, backslashes and control characters
+        // are copied at once
+        //
+
+        std::size_t run = 0;
+        for (std::size_t i = 0; i != value.size(); i++)
+        {
+            auto c = static_cast<unsigned char>(value[i]);
+            if (c >= 0x20 && c != '"' && c != '\\')
+                continue;
+
+            buffer.append(value, run, i - run);
+            run = i + 1;
+
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), c < 0x20 ? "\\u%04x" : "\\%c", c);
+            buffer += escaped;
+        }
+
+        buffer.append(value, run, std::string::npos);
+        buffer += '"';
+    }
+
+    void ChromeTraceLogger::close()
+    {
+        buffer += '}';
+        if (buffer.size() >= bufferSize)
+            flush();
+    }
+
+    // ----------------------------------------------------
+
+    void ChromeTraceLogger::slice(std::uint64_t time, std::string const& event, TrackedInfo const& info, TrackedInfo const* from)
+    {
+        open('X', time, lane);
+        buffer += ",\"dur\":0.001";
+        field("cat", "object");
+        field("name", event + " " + objectName(info));
+        buffer += ",\"args\":{\"id\":";
+        number(info.id);
+        field("type", typeName(info.type));
+        field("value", info.value.str());
+        field("site", siteName(info.site));
+        if (from)
+            field("from", objectName(*from));
+
+        buffer += '}';
+        close();
+    }
+
+    void ChromeTraceLogger::flow(std::uint64_t time, char const* kind, TrackedInfo const& from)
+    {
+        //
+        // The arrow starts at the slice that made the source; sources
+        // made before tracking, or dropped by sampling, have none
+        //
+
+        auto birth = births.find(from.id);
+        if (birth == births.end())
+            return;
+
+        nFlows++;
+
+        open('s', birth->second.time, birth->second.lane);
+        field("cat", kind);
+        field("name", kind);
+        buffer += ",\"id\":";
+        number(nFlows);
+        close();
+
+        open('f', time, lane);
+        field("cat", kind);
+        field("name", kind);
+        buffer += ",\"id\":";
+        number(nFlows);
+        buffer += ",\"bp\":\"e\"";
+        close();
+    }
+
+    void ChromeTraceLogger::born(std::uint64_t time, TrackedInfo const& info)
+    {
+        births[info.id] = { time, lane };
+
+        open('b', time, lane);
+        field("cat", "lifetime");
+        field("name", objectName(info));
+        buffer += ",\"id\":";
+        number(info.id);
+        close();
+    }
+
+    // ----------------------------------------------------
+
+    void ChromeTraceLogger::enterLane(int lane)
+    {
+        Logger::enterLane(lane);
+        if (!lanes.insert(lane).second)
+            return;
+
+        open('M', 0, lane);
+        field("name", "thread_name");
+        buffer += ",\"args\":{";
+        buffer += "\"name\":\"lane " + std::to_string(lane) + "\"}";
+        close();
+    }
+
+    void ChromeTraceLogger::enterFunction(int function)
+    {
+        open('B', now(), lane);
+        field("cat", "function");
+        field("name", functionName(function));
+        close();
+    }
+
+    void ChromeTraceLogger::exitFunction()
+    {
+        open('E', now(), lane);
+        close();
+    }
+
+    void ChromeTraceLogger::enterDTOR(TrackedInfo const& info)
+    {
+        auto time = now();
+        slice(time, "dtor", info);
+
+        auto birth = births.find(info.id);
+        if (birth == births.end())
+            return;
+
+        births.erase(birth);
+        open('e', time + instant, lane);
+        field("cat", "lifetime");
+        field("name", objectName(info));
+        buffer += ",\"id\":";
+        number(info.id);
+        close();
+    }
+
+    void ChromeTraceLogger::enterCTOR(TrackedInfo const& info)
+    {
+        auto time = now();
+        slice(time, "ctor", info);
+        born(time, info);
+    }
+
+    void ChromeTraceLogger::enterCTORCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+    {
+        auto time = now();
+        slice(time, "copy", infoTo, &infoFrom);
+        flow(time, "copy", infoFrom);
+        born(time, infoTo);
+    }
+
+    void ChromeTraceLogger::enterCTORMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+    {
+        auto time = now();
+        slice(time, "move", infoTo, &infoFrom);
+        flow(time, "move", infoFrom);
+        born(time, infoTo);
+    }
+
+    void ChromeTraceLogger::enterAsg(TrackedInfo const& info)
+    {
+        slice(now(), "asg", info);
+    }
+
+    void ChromeTraceLogger::enterAsgCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+    {
+        auto time = now();
+        slice(time, "copy=", infoTo, &infoFrom);
+        flow(time, "copy", infoFrom);
+    }
+
+    void ChromeTraceLogger::enterAsgMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+    {
+        auto time = now();
+        slice(time, "move=", infoTo, &infoFrom);
+        flow(time, "move", infoFrom);
+    }
+
+    void ChromeTraceLogger::enterAsgOper(TrackedInfo const& infoTo, TrackedInfo const& infoFrom, std::string const& oper)
+    {
+        auto time = now();
+        slice(time, oper + "=", infoTo, &infoFrom);
+        flow(time, "oper", infoFrom);
+    }
+
+    //
+    // A reallocation is a slice around the relocation of its
+    // elements, allocations and frees are instants
+    //
+
+    void ChromeTraceLogger::enterAlloc(AllocInfo const& info)
+    {
+        static char const* const events[] = { "alloc", "realloc", "free" };
+        auto event = events[static_cast<int>(info.kind)];
+
+        open(info.kind == AllocInfo::Kind::Realloc ? 'B' : 'i', now(), lane);
+        if (info.kind != AllocInfo::Kind::Realloc)
+            buffer += ",\"s\":\"t\"";
+
+        field("cat", "alloc");
+        field("name", std::string(event) + " " + typeName(info.type));
+        buffer += ",\"args\":{\"bytes\":" + std::to_string(std::uint64_t(info.count) * info.size);
+        field("site", siteName(info.site));
+        buffer += '}';
+        close();
+    }
+
+    void ChromeTraceLogger::exitAlloc(AllocInfo const& info)
+    {
+        open('E', now(), lane);
+        buffer += ",\"args\":{\"copies\":" + std::to_string(info.copies) +
+                  ",\"moves\":" + std::to_string(info.moves) + "}";
+        close();
+    }
+}
@@ -0,0 +1,74 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Clock.cpp
+
+Abstract:
+
+    Calibration of the time stamp counter against steady_clock.
+
+Author / Creation date:
+
+    JulesIMF / 03.04.22
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <Tracker.h>
+#include <chrono>
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+//
+// Defines
+//
+
+namespace Tracker
+{
+    static std::uint64_t const calibrationTime = 2000000; // ns
+
+    std::uint64_t Clock::steady()
+    {
+        using namespace std::chrono;
+        return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    Clock Clock::calibrate()
+    {
+        Clock clock;
+#if defined(__x86_64__)
+        //
+        // The counter is only a clock where it is invariant: it ticks at
+        // one rate in every power state and on every core
+        //
+
+        unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+        if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1 << 8)))
+            return clock;
+
+        auto steadyStart = steady();
+        auto ticksStart = __builtin_ia32_rdtsc();
+        auto steadyFinish = steadyStart;
+        while (steadyFinish - steadyStart < calibrationTime)
+            steadyFinish = steady();
+
+        auto ticks = __builtin_ia32_rdtsc() - ticksStart;
+        if (ticks == 0)
+            return clock;
+
+        clock.scale = ((steadyFinish - steadyStart) << 32) / ticks;
+        clock.origin = ticksStart;
+#endif
+        return clock;
+    }
+}
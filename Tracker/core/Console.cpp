@@ -8,7 +8,7 @@ Module Name:
 
 Abstract:
 
-    
+    Colored log on stdout.
 
 Author / Creation date:
 
@@ -25,6 +25,7 @@ Revision History:
 
 #include <Colors.h>
 #include <Tracker.h>
+#include <unistd.h>
 
 //
 // Defines
@@ -32,20 +33,37 @@ Revision History:
 
 namespace Tracker
 {
+    ConsoleLogger::ConsoleLogger() :
+        ConsoleLogger(Options{})
+    {
+    }
+
+    ConsoleLogger::ConsoleLogger(Options const& options) :
+        options(options),
+        isColored(options.colors == Colors::Always ||
+                  (options.colors == Colors::Auto && isatty(fileno(stdout))))
+    {
+        line.reserve(options.isBuffered ? bufferSize * 2 : 256);
+    }
+
     void ConsoleLogger::printAllign()
     {
         static int n = 0;
         static int const tabsize = 4;
-        printf("%d %*s", ++n, depth() * tabsize, "");
+        line += std::to_string(++n);
+        line += ' ';
+        printLane();
+        line.append(depth() * tabsize, ' ');
     }
 
     void ConsoleLogger::printColor(TextLogger::Color color, std::string const& str)
     {
+        char const* escape = nullptr;
         switch (color)
         {
         #define CONSOLE_LOGGER_COLOR(c) \
         case TextLogger::Color::c: \
-            printf("%s", TerminalColor::c); \
+            escape = TerminalColor::c; \
             break;
 
         CONSOLE_LOGGER_COLOR(BlackB);
@@ -56,20 +74,44 @@ namespace Tracker
         CONSOLE_LOGGER_COLOR(PurpleB);
         CONSOLE_LOGGER_COLOR(CyanB);
         CONSOLE_LOGGER_COLOR(WhiteB);
-        
-        default:
-        CONSOLE_LOGGER_COLOR(Default);
 
         #undef CONSOLE_LOGGER_COLOR
+
+        default:
+            break;
         }
 
-        printf("%s", str.c_str());
-        printf("%s", TerminalColor::Default);
+        //
+        // Every fragment ends in the default color, so
+        // default text needs no escapes
+        //
+
+        if (isColored && escape)
+        {
+            line += escape;
+            line += str;
+            line += TerminalColor::Default;
+        }
+
+        else
+            line += str;
+
+        if (options.isBuffered ? line.size() >= bufferSize : str.find('\n') != std::string::npos)
+            flush();
+    }
+
+    void ConsoleLogger::flush()
+    {
+        if (line.empty())
+            return;
+
+        fwrite(line.data(), 1, line.size(), stdout);
+        line.clear();
     }
 
     ConsoleLogger::~ConsoleLogger()
     {
-        auto total = mainLogger.getTotal();
-        printf("\n\n%d object%s created, %d copied, %d moved\n", total.obj, (total.obj != 1 ? "s" : ""), total.copy, total.move);
+        printSummary();
+        flush();
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,259 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Counters.cpp
+
+Abstract:
+
+    Event counts by modification type, tracked type and function.
+
+Author / Creation date:
+
+    JulesIMF / 20.03.22
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <Tracker.h>
+#include <algorithm>
+
+//
+// Defines
+//
+
+namespace Tracker
+{
+    static std::uint64_t sum(Counters::Row const& row, Counters::Kinds kinds)
+    {
+        std::uint64_t result = 0;
+        for (auto kind : kinds)
+            result += row[static_cast<int>(kind)];
+
+        return result;
+    }
+
+    static std::uint64_t sum(std::vector<Counters::Row> const& rows, int id, Counters::Kinds kinds)
+    {
+        if (id < -1 || std::size_t(id + 1) >= rows.size())
+            return 0;
+
+        return sum(rows[id + 1], kinds);
+    }
+
+    static std::uint64_t sum(std::uint64_t count, Counters::Kinds)
+    {
+        return count;
+    }
+
+    template <typename T>
+    static std::vector<Counters::Entry> top(std::vector<T> const& rows, Counters::Kinds kinds, std::size_t n)
+    {
+        std::vector<Counters::Entry> entries;
+        for (std::size_t i = 0; i != rows.size(); i++)
+        {
+            auto count = sum(rows[i], kinds);
+            if (count)
+                entries.push_back({ int(i) - 1, count });
+        }
+
+        n = std::min(n, entries.size());
+        std::partial_sort(entries.begin(), entries.begin() + n, entries.end(),
+                          [](Counters::Entry const& a, Counters::Entry const& b)
+                          {
+                              return a.count > b.count;
+                          });
+
+        entries.resize(n);
+        return entries;
+    }
+
+    // ----------------------------------------------------
+
+    void Counters::addAlloc(AllocInfo const& info)
+    {
+        switch (info.kind)
+        {
+        case AllocInfo::Kind::Alloc:
+            allocs.allocs++;
+            allocs.bytes += std::uint64_t(info.count) * info.size;
+            break;
+
+        case AllocInfo::Kind::Realloc:
+            allocs.reallocs++;
+            allocs.bytes += std::uint64_t(info.count) * info.size;
+            break;
+
+        case AllocInfo::Kind::Free:
+            allocs.frees++;
+            break;
+        }
+    }
+
+    void Counters::addRealloc(AllocInfo const& info)
+    {
+        allocs.copies += info.copies;
+        allocs.moves += info.moves;
+
+        if (info.copies)
+            row(relocationCopies, info.site) += info.copies;
+    }
+
+    void Counters::merge(Counters const& other)
+    {
+        auto mergeRows = [](std::vector<Row>& to, std::vector<Row> const& from)
+        {
+            if (to.size() < from.size())
+                to.resize(from.size(), Row{});
+
+            for (std::size_t i = 0; i != from.size(); i++)
+                for (int kind = 0; kind != nModificationTypes; kind++)
+                    to[i][kind] += from[i][kind];
+        };
+
+        for (int kind = 0; kind != nModificationTypes; kind++)
+            totals[kind] += other.totals[kind];
+
+        mergeRows(types, other.types);
+        mergeRows(functions, other.functions);
+        mergeRows(sites, other.sites);
+        mergeRows(typeBytes, other.typeBytes);
+        mergeRows(siteBytes, other.siteBytes);
+
+        for (int kind = 0; kind != nModificationTypes; kind++)
+            byteTotals[kind] += other.byteTotals[kind];
+
+        allocs.allocs += other.allocs.allocs;
+        allocs.reallocs += other.allocs.reallocs;
+        allocs.frees += other.allocs.frees;
+        allocs.bytes += other.allocs.bytes;
+        allocs.copies += other.allocs.copies;
+        allocs.moves += other.allocs.moves;
+
+        auto mergeCounts = [](std::vector<std::uint64_t>& to, std::vector<std::uint64_t> const& from)
+        {
+            if (to.size() < from.size())
+                to.resize(from.size());
+
+            for (std::size_t i = 0; i != from.size(); i++)
+                to[i] += from[i];
+        };
+
+        mergeCounts(temporaries, other.temporaries);
+        mergeCounts(relocationCopies, other.relocationCopies);
+        mergeCounts(calls, other.calls);
+        mergeCounts(inclusiveTimes, other.inclusiveTimes);
+        mergeCounts(exclusiveTimes, other.exclusiveTimes);
+    }
+
+    std::uint64_t Counters::total(Kinds kinds) const
+    {
+        return sum(totals, kinds);
+    }
+
+    std::uint64_t Counters::byType(int type, Kinds kinds) const
+    {
+        return sum(types, type, kinds);
+    }
+
+    std::uint64_t Counters::byFunction(int function, Kinds kinds) const
+    {
+        return sum(functions, function, kinds);
+    }
+
+    std::uint64_t Counters::bySite(int site, Kinds kinds) const
+    {
+        return sum(sites, site, kinds);
+    }
+
+    static std::uint64_t count(std::vector<std::uint64_t> const& counts, int id)
+    {
+        if (id < -1 || std::size_t(id + 1) >= counts.size())
+            return 0;
+
+        return counts[id + 1];
+    }
+
+    std::uint64_t Counters::temporariesAt(int site) const
+    {
+        return count(temporaries, site);
+    }
+
+    std::uint64_t Counters::relocationCopiesAt(int site) const
+    {
+        return count(relocationCopies, site);
+    }
+
+    std::uint64_t Counters::callsOf(int function) const
+    {
+        return count(calls, function);
+    }
+
+    std::uint64_t Counters::inclusiveTime(int function) const
+    {
+        return count(inclusiveTimes, function);
+    }
+
+    std::uint64_t Counters::exclusiveTime(int function) const
+    {
+        return count(exclusiveTimes, function);
+    }
+
+    std::uint64_t Counters::bytes(Kinds kinds) const
+    {
+        return sum(byteTotals, kinds);
+    }
+
+    std::uint64_t Counters::bytesByType(int type, Kinds kinds) const
+    {
+        return sum(typeBytes, type, kinds);
+    }
+
+    std::uint64_t Counters::bytesBySite(int site, Kinds kinds) const
+    {
+        return sum(siteBytes, site, kinds);
+    }
+
+    std::vector<Counters::Entry> Counters::topTypes(Kinds kinds, std::size_t n) const
+    {
+        return top(types, kinds, n);
+    }
+
+    std::vector<Counters::Entry> Counters::topFunctions(Kinds kinds, std::size_t n) const
+    {
+        return top(functions, kinds, n);
+    }
+
+    std::vector<Counters::Entry> Counters::topSites(Kinds kinds, std::size_t n) const
+    {
+        return top(sites, kinds, n);
+    }
+
+    std::vector<Counters::Entry> Counters::topTemporarySites(std::size_t n) const
+    {
+        return top(temporaries, {}, n);
+    }
+
+    std::vector<Counters::Entry> Counters::topRelocationSites(std::size_t n) const
+    {
+        return top(relocationCopies, {}, n);
+    }
+
+    std::vector<Counters::Entry> Counters::topTypesByBytes(Kinds kinds, std::size_t n) const
+    {
+        return top(typeBytes, kinds, n);
+    }
+
+    std::vector<Counters::Entry> Counters::topFunctionsByTime(std::size_t n, bool isExclusive) const
+    {
+        return top(isExclusive ? exclusiveTimes : inclusiveTimes, {}, n);
+    }
+}
@@ -0,0 +1,178 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Csv.cpp
+
+Abstract:
+
+    Event stream in CSV, one line per event.
+
+Author / Creation date:
+
+    JulesIMF / 29.03.22
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <Tracker.h>
+#include <stdexcept>
+
+//
+// Defines
+//
+
+namespace Tracker
+{
+    CsvLogger::CsvLogger(char const* filename)
+    {
+        file = fopen(filename, "w");
+        if (file == nullptr)
+            throw std::runtime_error(std::string("cant open \"") + filename + "\"");
+
+        fprintf(file, "event,depth,function,object,type,temporary,source,site,bytes\n");
+    }
+
+    CsvLogger::~CsvLogger()
+    {
+        fclose(file);
+    }
+
+    void CsvLogger::writeField(std::string const& field)
+    {
+        //
+        // Function names may hold commas and quotes
+        //
+
+        fputc(',', file);
+        if (field.find_first_of(",\"\n") == std::string::npos)
+        {
+            fputs(field.c_str(), file);
+            return;
+        }
+
+        fputc('"', file);
+        for (auto c : field)
+        {
+            if (c == '"')
+                fputc('"', file);
+
+            fputc(c, file);
+        }
+
+        fputc('"', file);
+    }
+
+    void CsvLogger::writeEvent(char const* event, TrackedInfo const* info, TrackedInfo const* from, std::uint64_t bytes)
+    {
+        auto function = ScopeStack::current ? ScopeStack::current->top() : -1;
+
+        fprintf(file, "%s,%d", event, depth());
+        writeField(function < 0 ? "" : functionName(function));
+        writeField(info ? objectName(*info) : "");
+        writeField(info ? typeName(info->type) : "");
+        fprintf(file, ",%d", info && info->isTemp());
+        writeField(from ? objectName(*from) : "");
+        writeField(info ? siteName(info->site) : "");
+        fprintf(file, ",%llu\n", (unsigned long long)bytes);
+    }
+
+    void CsvLogger::writeAlloc(char const* event, AllocInfo const& info, std::uint64_t count)
+    {
+        auto function = ScopeStack::current ? ScopeStack::current->top() : -1;
+
+        fprintf(file, "%s,%d", event, depth());
+        writeField(function < 0 ? "" : functionName(function));
+        writeField("");
+        writeField(typeName(info.type));
+        fprintf(file, ",0");
+        writeField("");
+        writeField(siteName(info.site));
+        fprintf(file, ",%llu\n", (unsigned long long)(count * info.size));
+    }
+
+    // ----------------------------------------------------
+
+    void CsvLogger::enterFunction(int function)
+    {
+        fprintf(file, "enter,%d", depth());
+        writeField(functionName(function));
+        fprintf(file, ",,,0,,,0\n");
+    }
+
+    void CsvLogger::exitFunction()
+    {
+        fprintf(file, "exit,%d,,,,0,,,0\n", depth());
+    }
+
+    void CsvLogger::enterDTOR(TrackedInfo const& info)
+    {
+        writeEvent("dtor", &info, nullptr, info.bytes);
+    }
+
+    void CsvLogger::enterCTOR(TrackedInfo const& info)
+    {
+        writeEvent("ctor", &info, nullptr, info.bytes);
+    }
+
+    void CsvLogger::enterCTORCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+    {
+        writeEvent("copy", &infoTo, &infoFrom, infoTo.bytes);
+    }
+
+    void CsvLogger::enterCTORMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+    {
+        writeEvent("move", &infoTo, &infoFrom, infoTo.bytes);
+    }
+
+    void CsvLogger::enterAsg(TrackedInfo const& info)
+    {
+        writeEvent("asg", &info, nullptr, info.bytes);
+    }
+
+    void CsvLogger::enterAsgCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+    {
+        writeEvent("copy=", &infoTo, &infoFrom, infoTo.bytes);
+    }
+
+    void CsvLogger::enterAsgMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+    {
+        writeEvent("move=", &infoTo, &infoFrom, infoTo.bytes);
+    }
+
+    void CsvLogger::enterAsgOper(TrackedInfo const& infoTo, TrackedInfo const& infoFrom, std::string const&)
+    {
+        writeEvent("oper=", &infoTo, &infoFrom, infoTo.bytes);
+    }
+
+    void CsvLogger::enterAlloc(AllocInfo const& info)
+    {
+        switch (info.kind)
+        {
+        case AllocInfo::Kind::Alloc:
+            writeAlloc("alloc", info, info.count);
+            break;
+
+        case AllocInfo::Kind::Realloc:
+            writeAlloc("realloc", info, info.count);
+            break;
+
+        case AllocInfo::Kind::Free:
+            writeAlloc("free", info, info.count);
+            break;
+        }
+    }
+
+    void CsvLogger::exitAlloc(AllocInfo const& info)
+    {
+        writeAlloc("realloc_end", info, info.previousCount);
+    }
+}
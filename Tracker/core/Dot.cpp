@@ -25,9 +25,17 @@ Revision History:
 
 #include <Tracker.h>
 #include <cassert>
+#include <cinttypes>
 #include <cstdarg>
+#include <cstring>
 #include <stdexcept>
+#include <thread>
+#include <unordered_map>
 #include <Colors.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 //
 // Defines
@@ -35,27 +43,380 @@ Revision History:
 
 namespace Tracker
 {
-    void DotLogger::enterFunction(std::string name)
+    static char const separator[] = "\n"
+                                    "// ---------------------------------------------------"
+                                    "--------------------------\n";
+
+    static std::string header(int cluster, std::string const& label, std::string const& style)
     {
-        write(nodes, "subgraph cluster_%d {\n", hypergraphs++);
-        write(nodes, "label=\"%s\"\n", name.c_str());
+        return "subgraph cluster_" + std::to_string(cluster) + " {\n"
+               "label=\"" + label + "\"\n" + style + separator;
+    }
 
+    void DotLogger::enterFunction(int function)
+    {
         int const step = 20;
         int color = 0xFF - ((depth() + 1) * step);
-        write(nodes, "style=filled; color=\"#%2x%2x%2x\"\n", color, color, color);
-        endPrintNode();
-        pushFunction(name);
+        char style[64];
+        snprintf(style, sizeof(style), "style=filled; color=\"#%2x%2x%2x\"\n", color, color, color);
+        openFrame(functionName(function), style, "F" + std::to_string(function) + "(");
     }
 
     void DotLogger::exitFunction()
     {
+        closeFrame();
+    }
+
+    //
+    // A reallocation is drawn as a cluster around the
+    // element events it caused
+    //
+
+    void DotLogger::enterAlloc(AllocInfo const& info)
+    {
+        if (info.kind != AllocInfo::Kind::Realloc)
+            return;
+
+        auto label = "realloc " + typeName(info.type) + "[" + std::to_string(info.previousCount) + "] -> " +
+                                  typeName(info.type) + "[" + std::to_string(info.count) + "]";
+
+        //
+        // Red when the type forces the container to copy
+        //
+
+        if (info.flags & AllocInfo::ThrowingMove)
+            openFrame(label + "\\nmove is not noexcept: elements are copied",
+                      "style=\"filled, dashed\"; color=\"#ed2b2b\"; fillcolor=\"#fbe8e8\"\n",
+                      "R" + std::to_string(info.type) + "(");
+        else
+            openFrame(label,
+                      "style=\"filled, dashed\"; color=\"#28b5d8\"; fillcolor=\"#e8f7fb\"\n",
+                      "R" + std::to_string(info.type) + "(");
+    }
+
+    void DotLogger::exitAlloc(AllocInfo const&)
+    {
+        closeFrame();
+    }
+
+    // ----------------------------------------------------
+
+    void DotLogger::openFrame(std::string const& label, std::string const& style, std::string const& signature)
+    {
+        int cluster = hypergraphs++;
+        clusters[lane].push_back(cluster);
+        if (hasLanes)
+        {
+            put(nodes, header(cluster, label, style));
+            return;
+        }
+
+        auto& parent = frames.back();
+        Frame frame;
+        frame.cluster = cluster;
+        frame.label = label;
+        frame.style = style;
+        frame.signature = signature;
+        frame.isHidden = parent.isHidden || isOverBudget;
+        frame.isBuffered = options.fold && !frame.isHidden;
+
+        compare(parent);
+        if (!frame.isHidden && !frame.isBuffered)
+        {
+            settle(parent);
+            put(nodes, header(cluster, label, style));
+        }
+
+        frames.push_back(std::move(frame));
+    }
+
+    void DotLogger::closeFrame()
+    {
+        clusters[lane].pop_back();
+        if (hasLanes)
+        {
+            put(nodes, "}\n");
+            return;
+        }
+
+        auto frame = std::move(frames.back());
+        frames.pop_back();
+        if (frame.isHidden)
+            return;
+
+        settle(frame);
+        if (!frame.isBuffered)
+        {
+            output(nodes, "}\n");
+            return;
+        }
+
+        //
+        // The call waits, with the events of the caller that follow
+        // it, to be compared with the previous one
+        //
+
+        frame.signature += ")";
+        auto& parent = frames.back();
+        (parent.held ? parent.candidate : parent.held) = std::make_unique<Frame>(std::move(frame));
+        limit();
+    }
+
+    //
+    // Folds the candidate into the held call when they are equal,
+    // otherwise the held call is written and the candidate takes its place
+    //
+
+    void DotLogger::compare(Frame& frame)
+    {
+        if (!frame.candidate)
+            return;
+
+        auto candidate = std::move(frame.candidate);
+        if (frame.held->signature == candidate->signature &&
+            frame.held->allocated.size() == candidate->allocated.size())
+        {
+            fold(*candidate, *frame.held);
+            return;
+        }
+
+        emit(*frame.held, frame);
+        frame.held = std::move(candidate);
+    }
+
+    void DotLogger::settle(Frame& frame)
+    {
+        compare(frame);
+        if (!frame.held)
+            return;
+
+        auto held = std::move(frame.held);
+        emit(*held, frame);
+    }
+
+    void DotLogger::emit(Frame& child, Frame& into)
+    {
+        auto label = child.label;
+        if (child.repeats > 1)
+            label += "\\n" + std::to_string(child.repeats) + " calls: " +
+                     std::to_string(child.copies) + " copies, " +
+                     std::to_string(child.moves) + " moves";
+
+        auto text = header(child.cluster, label, child.style) + child.nodes + "}\n" + child.trailerNodes;
+        if (!into.isBuffered)
+        {
+            output(nodes, text);
+            output(links, child.links + child.trailerLinks);
+            return;
+        }
+
+        into.nodes += text;
+        into.links += child.links + child.trailerLinks;
+        into.signature += child.signature + std::to_string(child.repeats);
+        into.allocated.insert(into.allocated.end(), child.allocated.begin(), child.allocated.end());
+        into.copies += child.copies;
+        into.moves += child.moves;
+    }
+
+    //
+    // Nodes of the folded call map to the nodes of held
+    // in the order they were drawn
+    //
+
+    void DotLogger::fold(Frame& child, Frame& held)
+    {
+        auto key = [](Node node)
+        {
+            return (std::uint64_t(std::uint32_t(node.id)) << 32) | std::uint32_t(node.index);
+        };
+
+        std::unordered_map<std::uint64_t, Node> counterparts;
+        for (std::size_t i = 0; i != child.allocated.size(); i++)
+            counterparts[key(child.allocated[i])] = held.allocated[i];
+
+        auto retarget = [&](Node& node)
+        {
+            auto counterpart = counterparts.find(key(node));
+            if (counterpart != counterparts.end())
+                node = counterpart->second;
+        };
+
+        for (auto& entry : redirects)
+        {
+            retarget(entry.second.first);
+            retarget(entry.second.latest);
+        }
+
+        for (auto node : child.allocated)
+        {
+            auto live = nodeById.find(node.id);
+            if (live == nodeById.end())
+                continue;
+
+            auto& redirect = redirects[node.id];
+            auto counterpart = counterparts[key(node)];
+            if (node.index == 0)
+                redirect.first = counterpart;
+
+            if (node.index == live->second - 1)
+            {
+                redirect.latest = counterpart;
+                redirect.latestIndex = node.index;
+            }
+        }
+
+        retarget(last);
+        held.repeats += child.repeats;
+        held.copies += child.copies;
+        held.moves += child.moves;
+        drawn -= child.allocated.size();
+    }
+
+    //
+    // Writes out frames up to upTo, outermost first,
+    // they are not folded from then on
+    //
+
+    void DotLogger::stream(std::size_t upTo)
+    {
+        for (std::size_t i = 1; i <= upTo; i++)
+        {
+            settle(frames[i - 1]);
+
+            auto& frame = frames[i];
+            if (!frame.isBuffered)
+                continue;
+
+            output(nodes, header(frame.cluster, frame.label, frame.style) + frame.nodes);
+            output(links, frame.links);
+            frame.nodes.clear();
+            frame.links.clear();
+            frame.signature.clear();
+            frame.allocated.clear();
+            frame.isBuffered = false;
+        }
+    }
+
+    std::size_t DotLogger::bytes(Frame const& frame)
+    {
+        return frame.nodes.size() + frame.links.size() + frame.trailerNodes.size() + frame.trailerLinks.size() +
+               (frame.held ? bytes(*frame.held) : 0) + (frame.candidate ? bytes(*frame.candidate) : 0);
+    }
+
+    void DotLogger::limit()
+    {
+        if (bytes(frames.back()) <= foldBytes)
+            return;
+
+        stream(frames.size() - 1);
+        settle(frames.back());
+    }
+
+    DotLogger::Frame* DotLogger::tail()
+    {
+        auto& frame = frames.back();
+        return frame.candidate ? frame.candidate.get() : frame.held.get();
+    }
+
+    DotLogger::Node DotLogger::resolve(Node node) const
+    {
+        auto redirect = redirects.find(node.id);
+        if (redirect == redirects.end())
+            return node;
+
+        if (node.index == 0 && redirect->second.first.id >= 0)
+            return redirect->second.first;
+
+        if (node.index == redirect->second.latestIndex)
+            return redirect->second.latest;
+
+        return node;
+    }
+
+    //
+    // Events of the scope after a call go to the call's trailer,
+    // they are compared and folded with it
+    //
+
+    bool DotLogger::beginEvent(Node node, char const* tag)
+    {
+        auto& frame = frames.back();
+        if (options.nodeBudget && drawn >= options.nodeBudget)
+            isOverBudget = true;
+
+        if (frame.isHidden || isOverBudget)
+        {
+            hidden++;
+            return false;
+        }
+
+        auto unit = tail() ? tail() : frame.isBuffered ? &frame : nullptr;
+        if (unit)
+        {
+            unit->signature += tag;
+            if (node.id >= 0)
+                unit->allocated.push_back(node);
+        }
+
+        drawn++;
+        return true;
+    }
+
+    void DotLogger::enterLane(int lane)
+    {
+        if (hasLanes && lane == this->lane)
+            return;
+
+        //
+        // Clusters of the previous lane are closed and the new lane's
+        // ones are reopened by name, dot merges subgraphs with equal names
+        //
+
+        if (hasLanes)
+            closeLane();
+
+        //
+        // Folding follows one call stack, it ends with the first lane
+        //
+
+        else
+        {
+            stream(frames.size() - 1);
+            settle(frames.back());
+            frames.resize(1);
+        }
+
+        lastByLane[this->lane] = last;
+        Logger::enterLane(lane);
+        auto it = lastByLane.find(lane);
+        last = it != lastByLane.end() ? it->second : Node{ -1, -1 };
+
+        write(nodes, "subgraph cluster_lane_%d {\n", lane);
+        write(nodes, "label=\"thread %d\"\n", lane);
+        for (int cluster : clusters[lane])
+            write(nodes, "subgraph cluster_%d {\n", cluster);
+
+        endPrintNode();
+    }
+
+    void DotLogger::closeLane()
+    {
+        for (size_t i = 0; i != clusters[lane].size(); i++)
+            write(nodes, "}\n");
+
         write(nodes, "}\n");
-        Logger::exitFunction();
     }
 
     void DotLogger::enterDTOR(TrackedInfo const& info)
     {
         auto node = allocNode(info.id);
+        if (!beginEvent(node, "D"))
+        {
+            nodeById.erase(info.id);
+            redirects.erase(info.id);
+            return;
+        }
+
         linkExec(node);
         assert(node.index);
         printNodeName(nodes, node);
@@ -64,15 +425,20 @@ namespace Tracker
                        "style = \"filled, bold\", "
                        "fillcolor = \"#3b8eea\", "
                        "fontsize = 15]\n",
-                       info.name.c_str());
+                       objectName(info).c_str());
         endPrintNode();
 
         link({ info.id, 0 }, node, LinkType::DTOR);
+        nodeById.erase(info.id);
+        redirects.erase(info.id);
     }
 
     void DotLogger::enterCTOR(TrackedInfo const& info)
     {
         auto node = allocNode(info.id);
+        if (!beginEvent(node, "C"))
+            return;
+
         logInfo(info, currentNode(info.id), "CTOR");
         linkExec(node);
         assert(!node.index);
@@ -81,24 +447,35 @@ namespace Tracker
     void DotLogger::enterCTORCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
     {
         auto node = allocNode(infoTo.id);
+        if (!beginEvent(node, "c"))
+            return;
+
+        frames.back().copies++;
         logInfo(infoTo, currentNode(infoTo.id), "COPY", "f14c4c");
         linkExec(node);
         assert(!node.index);
-        link(currentNode(infoFrom.id), node, LinkType::Copy);
+        link(sourceNode(infoFrom), node, LinkType::Copy);
     }
 
     void DotLogger::enterCTORMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
     {
         auto node = allocNode(infoTo.id);
+        if (!beginEvent(node, "m"))
+            return;
+
+        frames.back().moves++;
         logInfo(infoTo, currentNode(infoTo.id), "MOVE", "23d18b");
         linkExec(node);
         assert(!node.index);
-        link(currentNode(infoFrom.id), node, LinkType::Move);
+        link(sourceNode(infoFrom), node, LinkType::Move);
     }
 
     void DotLogger::enterAsg(TrackedInfo const& info)
     {
         auto node = allocNode(info.id);
+        if (!beginEvent(node, "a"))
+            return;
+
         logInfo(info, currentNode(info.id), "Literal assign");
         linkExec(node);
     }
@@ -106,25 +483,36 @@ namespace Tracker
     void DotLogger::enterAsgCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
     {
         auto node = allocNode(infoTo.id);
+        if (!beginEvent(node, "C="))
+            return;
+
+        frames.back().copies++;
         logInfo(infoTo, currentNode(infoTo.id), "COPY assign", "f14c4c");
         linkExec(node);
-        link(currentNode(infoFrom.id), node, LinkType::Copy);
+        link(sourceNode(infoFrom), node, LinkType::Copy);
     }
 
     void DotLogger::enterAsgMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
     {
         auto node = allocNode(infoTo.id);
+        if (!beginEvent(node, "M="))
+            return;
+
+        frames.back().moves++;
         logInfo(infoTo, currentNode(infoTo.id), "MOVE assign", "23d18b");
         linkExec(node);
-        link(currentNode(infoFrom.id), node, LinkType::Move);
+        link(sourceNode(infoFrom), node, LinkType::Move);
     }
 
     void DotLogger::enterAsgOper(TrackedInfo const& infoTo, TrackedInfo const& infoFrom, std::string const& oper)
     {
         auto node = allocNode(infoTo.id);
+        if (!beginEvent(node, ("o" + oper).c_str()))
+            return;
+
         logInfo(infoTo, currentNode(infoTo.id), oper + "=");
         linkExec(node);
-        link(currentNode(infoFrom.id), node, LinkType::Asg);
+        link(sourceNode(infoFrom), node, LinkType::Asg);
     }
 
     DotLogger::Node DotLogger::allocNode(int id)
@@ -152,6 +540,25 @@ namespace Tracker
         return { id, index };
     }
 
+    //
+    // A source the graph has not drawn was made before tracking, below
+    // TRACKER_LEVEL or outside the sample. It is drawn where it is
+    // first used; one without an id gets a node for every use.
+    //
+
+    DotLogger::Node DotLogger::sourceNode(TrackedInfo const& info)
+    {
+        auto live = nodeById.find(info.id);
+        if (live != nodeById.end() && live->second)
+            return currentNode(info.id);
+
+        auto node = info.id >= 0 ? allocNode(info.id) : Node{ -2 - nUntracked++, 0 };
+        if (beginEvent(node, "u"))
+            logInfo(info, node, "Untracked", "808080");
+
+        return node;
+    }
+
     void DotLogger::logInfo(TrackedInfo const& info, Node node, std::string const& reason, char const* color)
     {
         printNodeName(nodes, node);
@@ -166,23 +573,25 @@ namespace Tracker
                         "<TR>\n"
                         "<TD>id: <b><FONT COLOR=\"#d670d6\">\"%d\"</FONT></b></TD>\n"
                         "<TD>val: <b><FONT COLOR=\"#d670d6\">\"%s\"</FONT></b></TD>\n"
-                        "<TD>addr: <b><FONT COLOR=\"#d670d6\">\"%x\"</FONT></b></TD>\n"
+                        "<TD>addr: <b><FONT COLOR=\"#d670d6\">\"%08" PRIxPTR "\"</FONT></b></TD>\n"
                         "</TR>\n"
                         "</TABLE>\n"
                         ">];\n\n",
                         
-                        info.name.c_str(),
+                        objectName(info).c_str(),
                         color,
                         reason.c_str(),
                         info.id,
-                        info.value.c_str(),
-                        info.address);
+                        info.value.str().c_str(),
+                        reinterpret_cast<std::uintptr_t>(info.address));
         
         endPrintNode();
     }
 
     void DotLogger::link(Node from, Node to, LinkType type)
     {
+        from = resolve(from);
+        to = resolve(to);
         printNodeName(links, from);
         write(links, " -> ");
         printNodeName(links, to);
@@ -233,91 +642,236 @@ namespace Tracker
     {
         assert(node.index >= 0);
         
-        write(file, "node_id_%d_index_%d", node.id, node.index);
+        if (node.id < 0)
+            write(file, "node_untracked_%d", -2 - node.id);
+        else
+            write(file, "node_id_%d_index_%d", node.id, node.index);
         
     }
 
-    DotLogger::DotLogger()
+    DotLogger::DotLogger() :
+        DotLogger(Options{})
     {
-        links = fopen(linksFilename, "w");
+    }
+
+    DotLogger::DotLogger(Options const& options) :
+        options(options),
+        imageFilename(std::string("trackedlog.") + options.format)
+    {
+        links = fopen(linksFilename, "w+");
         if (links == nullptr)
             throw std::runtime_error(std::string("cant open \"") + linksFilename + "\"");
 
-        nodes = fopen(nodesFilename, "w");
+        nodes = fopen(finalFilename, "w");
         if (nodes == nullptr)
-            throw std::runtime_error(std::string("cant open \"") + nodesFilename + "\"");
+            throw std::runtime_error(std::string("cant open \"") + finalFilename + "\"");
+
+        setvbuf(links, nullptr, _IOFBF, bufferSize);
+        setvbuf(nodes, nullptr, _IOFBF, bufferSize);
 
         write(nodes, "digraph\n"
                        "{\n"
-                       "dpi = 400;\n");
+                       "dpi = %d;\n", options.dpi);
     }
 
     DotLogger::~DotLogger()
     {
+        if (hasLanes)
+            closeLane();
+
+        else
+        {
+            stream(frames.size() - 1);
+            settle(frames.back());
+        }
+
+        if (hidden)
+            write(nodes, "budget_note [shape=note, label=\"node budget of %d reached: %ld events not drawn\"];\n",
+                         options.nodeBudget, hidden);
+
         write(links, "}\n");
-        flushEntries();
+        flushEntries(true);
+        appendLinks();
         fclose(nodes);
         fclose(links);
-        char request[1024];
+        remove(linksFilename);
+        render();
+    }
 
-        snprintf(request, sizeof(request) - 1, "cat %s %s > %s", nodesFilename, linksFilename, finalFilename);
-        system(request);
+    void DotLogger::appendLinks()
+    {
+        char buffer[bufferSize];
+        fflush(links);
+        rewind(links);
 
-        message("rendering graph log...\n");
-        snprintf(request, sizeof(request) - 1, "dot -Tpng %s -o %s 2> dotfiles/dotlog.txt", finalFilename, imageFilename);
-        system(request);
-        message("graph log saved to %s\n", imageFilename);
+        std::size_t size = 0;
+        while ((size = fread(buffer, 1, sizeof(buffer), links)))
+            fwrite(buffer, 1, size, nodes);
+    }
+
+    void DotLogger::render()
+    {
+        std::string format = std::string("-T") + options.format;
+        if (options.render == Render::None)
+        {
+            message("graph log saved to %s, render it with\n"
+                    "    dot %s %s -o %s\n",
+                    finalFilename, format.c_str(), finalFilename, imageFilename.c_str());
+            return;
+        }
+
+        char const* argv[] = { "dot", format.c_str(), finalFilename, "-o", imageFilename.c_str(), nullptr };
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, dotlogFilename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+        pid_t pid = 0;
+        int error = posix_spawnp(&pid, "dot", &actions, nullptr, const_cast<char* const*>(argv), environ);
+        posix_spawn_file_actions_destroy(&actions);
+
+        if (error)
+        {
+            message("cant run dot: %s, graph log saved to %s\n", strerror(error), finalFilename);
+            return;
+        }
+
+        if (options.render == Render::Blocking)
+        {
+            message("rendering graph log...\n");
+            waitpid(pid, nullptr, 0);
+            message("graph log saved to %s\n", imageFilename.c_str());
+            return;
+        }
+
+        //
+        // The child outlives a process that is exiting. One
+        // that keeps running reaps it from this thread.
+        //
+
+        message("rendering graph log to %s in the background\n", imageFilename.c_str());
+        std::thread([pid]()
+        {
+            waitpid(pid, nullptr, 0);
+        }).detach();
     }
 
     void DotLogger::endPrintNode()
     {
-        write(nodes, "\n"
-                       "// ---------------------------------------------------"
-                       "--------------------------\n");
+        put(nodes, separator);
+    }
+
+    static std::string format(char const* fmt, va_list va)
+    {
+        va_list copy;
+        va_copy(copy, va);
+        int length = vsnprintf(nullptr, 0, fmt, copy);
+        va_end(copy);
+
+        std::string result(length > 0 ? length : 0, '\0');
+        vsnprintf(result.data(), result.size() + 1, fmt, va);
+        return result;
     }
 
     void DotLogger::write(FILE* file, char const* fmt, ...)
     {
-        static char buf[1024];
         va_list va;
         va_start(va, fmt);
-        vsnprintf(buf, sizeof(buf) - 1, fmt, va);
+        auto const& frame = frames.back();
+        if (pending.empty() && !frame.isBuffered && !frame.isHidden && !tail())
+            vfprintf(file, fmt, va);
+        else
+            put(file, format(fmt, va));
         va_end(va);
-        entriesFlow.push_back(FileEntry{ .file = file,
-                                       .isResolved = true,
-                                       .content = buf });
+    }
+
+    void DotLogger::put(FILE* file, std::string const& text)
+    {
+        auto& frame = frames.back();
+        if (frame.isHidden)
+            return;
+
+        if (auto unit = tail())
+            (file == nodes ? unit->trailerNodes : unit->trailerLinks) += text;
+        else if (frame.isBuffered)
+            (file == nodes ? frame.nodes : frame.links) += text;
+        else
+        {
+            output(file, text);
+            return;
+        }
+
+        limit();
+    }
+
+    void DotLogger::output(FILE* file, std::string const& text)
+    {
+        if (text.empty())
+            return;
+
+        if (pending.empty())
+            fputs(text.c_str(), file);
+        else
+            pending.push_back(FileEntry{ .file = file,
+                                         .isResolved = true,
+                                         .content = text });
     }
 
     void DotLogger::setEntryContent(std::string const& entryName, char const* fmt, ...)
     {
-        static char buf[1024];
         va_list va;
         va_start(va, fmt);
-        vsnprintf(buf, sizeof(buf) - 1, fmt, va);
+        patches[entryName] = format(fmt, va);
         va_end(va);
-        entryContentByName[entryName] = buf;
+
+        flushEntries();
     }
 
     void DotLogger::pushEntry(FILE* file, std::string const& entryName)
     {
-        entriesFlow.push_back(FileEntry{ .file = file,
+        auto patch = patches.find(entryName);
+        if (patch != patches.end())
+        {
+            put(file, patch->second);
+            return;
+        }
+
+        //
+        // Held back entries keep their order only in the files
+        //
+
+        stream(frames.size() - 1);
+        settle(frames.back());
+        pending.push_back(FileEntry{ .file = file,
                                          .isResolved = false,
                                          .content = entryName });
     }
 
-    void DotLogger::flushEntries()
+    //
+    // Writes the held back entries up to the first one that is
+    // still unresolved, or all of them when the log ends
+    //
+
+    void DotLogger::flushEntries(bool isFinal)
     {
-        for (auto const& entry : entriesFlow)
+        while (!pending.empty())
         {
+            auto const& entry = pending.front();
             if (entry.isResolved)
-                fprintf(entry.file, "%s", entry.content.c_str());
-            
+                fputs(entry.content.c_str(), entry.file);
+
             else
-                fprintf(entry.file, "%s", entryContentByName[entry.content].c_str());
-        }
+            {
+                auto patch = patches.find(entry.content);
+                if (patch == patches.end() && !isFinal)
+                    break;
 
-        entriesFlow.clear();
-        entryContentByName.clear();
+                if (patch != patches.end())
+                    fputs(patch->second.c_str(), entry.file);
+            }
+
+            pending.pop_front();
+        }
     }
 
     void DotLogger::message(char const* fmt, ...)
@@ -0,0 +1,187 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Flame.cpp
+
+Abstract:
+
+    Folded stacks, weighted by wall time or by copies.
+
+Author / Creation date:
+
+    JulesIMF / 03.04.22
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <Tracker.h>
+#include <stdexcept>
+
+//
+// Defines
+//
+
+namespace Tracker
+{
+    FlameLogger::FlameLogger(Weight weight, char const* filename) :
+        weight(weight),
+        frames(&lanes[0])
+    {
+        file = fopen(filename, "w");
+        if (file == nullptr)
+            throw std::runtime_error(std::string("cant open \"") + filename + "\"");
+    }
+
+    FlameLogger::~FlameLogger()
+    {
+        //
+        // Scopes still open end with the last event
+        //
+
+        for (auto& lane : lanes)
+        {
+            frames = &lane.second;
+            while (!frames->empty())
+                exitFunction();
+        }
+
+        for (std::size_t i = 0; i != nodes.size(); i++)
+        {
+            if (nodes[i].weight == 0)
+                continue;
+
+            write(i);
+            fprintf(file, " %llu\n", (unsigned long long)nodes[i].weight);
+        }
+
+        fclose(file);
+    }
+
+    int FlameLogger::child(int parent, int function)
+    {
+        auto found = children.find({ parent, function });
+        if (found != children.end())
+            return found->second;
+
+        nodes.push_back({ function, parent, 0 });
+        children[{ parent, function }] = nodes.size() - 1;
+        return nodes.size() - 1;
+    }
+
+    int FlameLogger::top()
+    {
+        return frames->empty() ? -1 - lane : frames->back().node;
+    }
+
+    void FlameLogger::write(int node)
+    {
+        //
+        // Frames are separated by semicolons, the weight by the last
+        // space. Semicolons in template arguments become commas.
+        //
+
+        if (node < 0)
+        {
+            if (hasLanes)
+                fprintf(file, "lane %d", -1 - node);
+
+            return;
+        }
+
+        write(nodes[node].parent);
+        if (nodes[node].parent >= 0 || hasLanes)
+            fputc(';', file);
+
+        auto name = nodes[node].function < 0 ? std::string("(global)") : functionName(nodes[node].function);
+        for (auto& c : name)
+            if (c == ';')
+                c = ',';
+
+        fputs(name.c_str(), file);
+    }
+
+    void FlameLogger::addCopy()
+    {
+        if (weight != Weight::Copies)
+            return;
+
+        //
+        // Copies outside of any scope are given a node of their own
+        //
+
+        auto node = frames->empty() ? child(top(), -1) : top();
+        nodes[node].weight++;
+    }
+
+    // ----------------------------------------------------
+
+    void FlameLogger::enterLane(int lane)
+    {
+        Logger::enterLane(lane);
+        frames = &lanes[lane];
+    }
+
+    void FlameLogger::enterFunction(int function)
+    {
+        frames->push_back({ child(top(), function), eventTime(), 0 });
+    }
+
+    void FlameLogger::exitFunction()
+    {
+        if (frames->empty())
+            return;
+
+        auto frame = frames->back();
+        frames->pop_back();
+
+        auto inclusive = eventTime() - frame.entered;
+        if (weight == Weight::Time)
+            nodes[frame.node].weight += inclusive - frame.nested;
+
+        if (!frames->empty())
+            frames->back().nested += inclusive;
+    }
+
+    void FlameLogger::enterCTORCopy(TrackedInfo const&, TrackedInfo const&)
+    {
+        addCopy();
+    }
+
+    void FlameLogger::enterAsgCopy(TrackedInfo const&, TrackedInfo const&)
+    {
+        addCopy();
+    }
+
+    void FlameLogger::enterDTOR(TrackedInfo const&)
+    {
+    }
+
+    void FlameLogger::enterCTOR(TrackedInfo const&)
+    {
+    }
+
+    void FlameLogger::enterCTORMove(TrackedInfo const&, TrackedInfo const&)
+    {
+    }
+
+    void FlameLogger::enterAsg(TrackedInfo const&)
+    {
+    }
+
+    void FlameLogger::enterAsgMove(TrackedInfo const&, TrackedInfo const&)
+    {
+    }
+
+    void FlameLogger::enterAsgOper(TrackedInfo const&, TrackedInfo const&, std::string const&)
+    {
+    }
+}
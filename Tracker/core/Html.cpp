@@ -8,7 +8,8 @@ Module Name:
 
 Abstract:
 
-
+    HTML log: an index page with the pages of the log
+    loaded on demand.
 
 Author / Creation date:
 
@@ -28,6 +29,7 @@ Revision History:
 #include <stdexcept>
 #include <chrono>
 #include <ctime>
+#include <sys/stat.h>
 
 //
 // Defines
@@ -35,80 +37,304 @@ Revision History:
 
 namespace Tracker
 {
+    static int const tabsize = 4;
+
+    //
+    // Page text is the body of a JS string literal
+    //
+
+    static void escape(std::string& to, std::string const& str, bool isScript)
+    {
+        for (char c : str)
+        {
+            switch (c)
+            {
+            case '&':
+                to += "&amp;";
+                break;
+
+            case '<':
+                to += "&lt;";
+                break;
+
+            case '>':
+                to += "&gt;";
+                break;
+
+            case '"':
+                to += "&quot;";
+                break;
+
+            case '\\':
+                to += isScript ? "\\\\" : "\\";
+                break;
+
+            case '\n':
+                to += isScript ? "\\n" : "\n";
+                break;
+
+            default:
+                to += c;
+            }
+        }
+    }
+
     HtmlLogger::HtmlLogger()
     {
         file = fopen(filename, "w");
         if (file == nullptr)
             throw std::runtime_error(std::string("cant open \"") + filename + "\"");
-        
-        fprintf(file, "<pre style = \"background-color: #1e1e1e; color: #FFFFFF\"><span class=\"inner-pre\" style=\"font-size: %dpx\">\n", fontSize);
+
+        mkdir(directory, 0755);
+        fprintf(file, "<!DOCTYPE html>\n"
+                      "<html>\n"
+                      "<head>\n"
+                      "<meta charset=\"utf-8\">\n"
+                      "<title>Tracker log</title>\n"
+                      "<style>\n"
+                      "body { background-color: #1e1e1e; color: #FFFFFF; margin: 8px }\n"
+                      "pre { margin: 0; font-size: %dpx }\n"
+                      "summary { cursor: pointer }\n"
+                      "details.page { border-top: 1px solid #333333 }\n"
+                      "details.page > summary { color: #666666; font-family: monospace; font-size: %dpx }\n"
+                      "</style>\n"
+                      "<script>\n"
+                      "function load(page, n)\n"
+                      "{\n"
+                      "    if (!page.open || page.dataset.loaded)\n"
+                      "        return;\n"
+                      "\n"
+                      "    page.dataset.loaded = 1;\n"
+                      "    var script = document.createElement('script');\n"
+                      "    script.src = '%s/page_' + String(n).padStart(5, '0') + '.js';\n"
+                      "    document.head.appendChild(script);\n"
+                      "}\n"
+                      "\n"
+                      "function trackerPage(n, html)\n"
+                      "{\n"
+                      "    document.getElementById('page_' + n).innerHTML = html;\n"
+                      "}\n"
+                      "</script>\n"
+                      "</head>\n"
+                      "<body>\n", fontSize, fontSize, directory);
+
+        isIndex = true;
         printColor(Color::RedB, "Tracker log ");
         auto currentTime = time(NULL);
-        printColor(Color::Default, "generated on " + std::string(std::ctime(&currentTime)) + "\n\n");
+        printColor(Color::Default, "generated on " + std::string(std::ctime(&currentTime)));
+        flushIndex();
+        isIndex = false;
     }
 
     HtmlLogger::~HtmlLogger()
     {
-        auto total = mainLogger.getTotal();
-        fprintf(file, "\n\n%d object%s created, %d copied, %d moved\n", total.obj, (total.obj != 1 ? "s" : ""), total.copy, total.move);
-        fprintf(file, "</span></pre>");
+        flushPage();
+        isIndex = true;
+        printSummary();
+        flushIndex();
+
+        //
+        // The first page is opened, the rest on demand
+        //
+
+        fprintf(file, "<script>\n"
+                      "var first = document.querySelector('details.page');\n"
+                      "if (first)\n"
+                      "    first.open = true;\n"
+                      "</script>\n"
+                      "</body>\n"
+                      "</html>\n");
         fclose(file);
     }
 
+    void HtmlLogger::enterFunction(int function)
+    {
+        if (hasLanes)
+        {
+            TextLogger::enterFunction(function);
+            return;
+        }
+
+        if (page.size() >= pageBytes)
+            flushPage();
+
+        nLines++;
+        Scope scope = { functionName(function), {} };
+        auto size = page.size();
+        printIndent();
+        scope.indent = page.substr(size);
+        page.resize(size);
+
+        openScope(scope);
+        scopes.push_back(std::move(scope));
+        printAllign();
+        printColor(Color::Default, "{\n");
+    }
+
+    void HtmlLogger::exitFunction()
+    {
+        TextLogger::exitFunction();
+        if (scopes.empty())
+            return;
+
+        page += "</details>";
+        scopes.pop_back();
+    }
+
+    void HtmlLogger::openScope(Scope const& scope, char const* suffix)
+    {
+        page += "<details open><summary>";
+        page += scope.indent;
+        append(scope.name + suffix);
+        page += "</summary>";
+    }
+
+    //
+    // Pages break between lines only
+    //
+
     void HtmlLogger::printAllign()
     {
-        // static int n = 0;
-        // fprintf(file, "%d ", ++n);
-        static int const tabsize = 4;
-        fprintf(file, "%*s", depth() * tabsize, "");
+        if (page.size() >= pageBytes)
+            flushPage();
+
+        //
+        // Scopes of different threads interleave, they are not folded
+        //
+
+        if (hasLanes && !scopes.empty())
+        {
+            for (std::size_t i = 0; i != scopes.size(); i++)
+                page += "</details>";
+
+            scopes.clear();
+        }
+
+        nLines++;
+        printIndent();
+    }
+
+    void HtmlLogger::printIndent()
+    {
+        printLane();
+        page.append(depth() * tabsize, ' ');
     }
 
     void HtmlLogger::printColor(TextLogger::Color color, std::string const& str)
     {
+        char const* hex = nullptr;
         switch (color)
         {
         case TextLogger::Color::BlackB:
-            fprintf(file, "<font color=#%s>", "666666");
-            fprintf(file, "%s</font></b>", str.c_str());
+            hex = "666666";
             break;
-        
+
         case TextLogger::Color::RedB:
-            fprintf(file, "<b><font color=#%s>", "f14c4c");
-            fprintf(file, "%s</font></b>", str.c_str());
+            hex = "f14c4c";
             break;
-        
+
         case TextLogger::Color::GreenB:
-            fprintf(file, "<b><font color=#%s>", "23d18b");
-            fprintf(file, "%s</font></b>", str.c_str());
+            hex = "23d18b";
             break;
 
         case TextLogger::Color::YellowB:
-            fprintf(file, "<b><font color=#%s>", "f5f543");
-            fprintf(file, "%s</font></b>", str.c_str());
+            hex = "f5f543";
             break;
-        
+
         case TextLogger::Color::BlueB:
-            fprintf(file, "<b><font color=#%s>", "3b8eea");
-            fprintf(file, "%s</font></b>", str.c_str());
+            hex = "3b8eea";
             break;
-        
+
         case TextLogger::Color::PurpleB:
-            fprintf(file, "<b><font color=#%s>", "d670d6");
-            fprintf(file, "%s</font></b>", str.c_str());
+            hex = "d670d6";
             break;
-        
+
         case TextLogger::Color::CyanB:
-            fprintf(file, "<b><font color=#%s>", "28b5d8");
-            fprintf(file, "%s</font></b>", str.c_str());
+            hex = "28b5d8";
             break;
 
         case TextLogger::Color::WhiteB:
-            fprintf(file, "<b><font color=#%s>", "e5e5e5");
-            fprintf(file, "%s</font></b>", str.c_str());
+            hex = "e5e5e5";
             break;
 
         default:
-            fprintf(file, "%s", str.c_str());
+            append(str);
+            return;
         }
+
+        bool isBold = color != TextLogger::Color::BlackB;
+        page += isBold ? "<b><font color=#" : "<font color=#";
+        page += hex;
+        page += ">";
+        append(str);
+        page += isBold ? "</font></b>" : "</font>";
+    }
+
+    void HtmlLogger::append(std::string const& str)
+    {
+        escape(page, str, !isIndex);
+    }
+
+    // ----------------------------------------------------
+
+    void HtmlLogger::flushPage()
+    {
+        if (nLines < firstLine)
+            return;
+
+        for (std::size_t i = 0; i != scopes.size(); i++)
+            page += "</details>";
+
+        writePage(nPages, page);
+
+        std::string where;
+        if (!pageScope.empty())
+        {
+            where = ", in ";
+            escape(where, pageScope, false);
+        }
+
+        fprintf(file, "<details class=\"page\" ontoggle=\"load(this, %d)\">"
+                      "<summary>page %d: lines %ld-%ld%s</summary>"
+                      "<pre id=\"page_%d\">loading...</pre>"
+                      "</details>\n",
+                      nPages, nPages + 1, firstLine, nLines, where.c_str(), nPages);
+
+        //
+        // Open scopes continue on the next page
+        //
+
+        nPages++;
+        firstLine = nLines + 1;
+        page.clear();
+        for (auto const& scope : scopes)
+            openScope(scope, " (continued)");
+
+        pageScope = scopes.empty() ? std::string() : scopes.back().name;
+    }
+
+    void HtmlLogger::writePage(int number, std::string const& content)
+    {
+        char name[256] = "";
+        snprintf(name, sizeof(name), "%s/page_%05d.js", directory, number);
+
+        FILE* script = fopen(name, "w");
+        if (script == nullptr)
+        {
+            fprintf(stderr, "%sHtmlLogger: %scant open \"%s\", page %d is lost\n",
+                    TerminalColor::PurpleB, TerminalColor::Default, name, number + 1);
+            return;
+        }
+
+        fprintf(script, "trackerPage(%d, \"", number);
+        fwrite(content.data(), 1, content.size(), script);
+        fprintf(script, "\");\n");
+        fclose(script);
+    }
+
+    void HtmlLogger::flushIndex()
+    {
+        fprintf(file, "<pre>%s</pre>\n", page.c_str());
+        page.clear();
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,179 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Merge.cpp
+
+Abstract:
+
+    Per-thread event buffers merged into one timeline.
+
+Author / Creation date:
+
+    JulesIMF / 14.03.22
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <Tracker.h>
+#include <Record.h>
+#include <algorithm>
+
+//
+// Defines
+//
+
+namespace Tracker
+{
+    MergeLogger::MergeLogger(Logger* target) :
+        target(target)
+    {
+    }
+
+    MergeLogger::~MergeLogger()
+    {
+        flush();
+        delete target;
+    }
+
+    void MergeLogger::attach(MainLoggerBase const* owner)
+    {
+        Logger::attach(owner);
+        target->attach(owner);
+    }
+
+    EventRecord& MergeLogger::record(EventRecord::Kind kind)
+    {
+        auto& buffer = buffers.local();
+        buffer.records.emplace_back();
+
+        auto& record = buffer.records.back();
+        record.kind = kind;
+        record.lane = buffer.lane;
+        record.time = eventTime();
+        return record;
+    }
+
+    void MergeLogger::record(EventRecord::Kind kind, TrackedInfo const& infoTo, TrackedInfo const* infoFrom)
+    {
+        auto& record = this->record(kind);
+        encode(record.to, infoTo);
+        if (infoFrom)
+            encode(record.from, *infoFrom);
+    }
+
+    void MergeLogger::flush()
+    {
+        std::vector<EventRecord> timeline;
+        buffers.forEach([&](Buffer const& buffer)
+        {
+            timeline.insert(timeline.end(), buffer.records.begin(), buffer.records.end());
+        });
+
+        buffers.forEach([](Buffer& buffer)
+        {
+            buffer.records.clear();
+        });
+
+        //
+        // Records of one thread are already ordered,
+        // stable sort keeps them so on equal timestamps
+        //
+
+        std::stable_sort(timeline.begin(), timeline.end(), [](EventRecord const& a, EventRecord const& b)
+        {
+            return a.time < b.time;
+        });
+
+        //
+        // Every lane is replayed against its own scope stack
+        //
+
+        auto calls = ScopeStack::current;
+        int lane = -1;
+        for (auto const& record : timeline)
+        {
+            if (record.lane != lane)
+            {
+                lane = record.lane;
+                ScopeStack::current = &laneCalls[lane];
+                target->enterLane(lane);
+            }
+
+            replay(*target, record);
+        }
+
+        ScopeStack::current = calls;
+    }
+
+    void MergeLogger::enterFunction(int function)
+    {
+        record(EventRecord::Kind::Function).function = function;
+    }
+
+    void MergeLogger::exitFunction()
+    {
+        record(EventRecord::Kind::ExitFunction);
+    }
+
+    void MergeLogger::enterAlloc(AllocInfo const& info)
+    {
+        record(EventRecord::Kind::Alloc).alloc = info;
+    }
+
+    void MergeLogger::exitAlloc(AllocInfo const& info)
+    {
+        record(EventRecord::Kind::ExitAlloc).alloc = info;
+    }
+
+    void MergeLogger::enterDTOR(TrackedInfo const& info)
+    {
+        record(EventRecord::Kind::DTOR, info);
+    }
+
+    void MergeLogger::enterCTOR(TrackedInfo const& info)
+    {
+        record(EventRecord::Kind::CTOR, info);
+    }
+
+    void MergeLogger::enterCTORCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+    {
+        record(EventRecord::Kind::CTORCopy, infoTo, &infoFrom);
+    }
+
+    void MergeLogger::enterCTORMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+    {
+        record(EventRecord::Kind::CTORMove, infoTo, &infoFrom);
+    }
+
+    void MergeLogger::enterAsg(TrackedInfo const& info)
+    {
+        record(EventRecord::Kind::Asg, info);
+    }
+
+    void MergeLogger::enterAsgCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+    {
+        record(EventRecord::Kind::AsgCopy, infoTo, &infoFrom);
+    }
+
+    void MergeLogger::enterAsgMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+    {
+        record(EventRecord::Kind::AsgMove, infoTo, &infoFrom);
+    }
+
+    void MergeLogger::enterAsgOper(TrackedInfo const& infoTo, TrackedInfo const& infoFrom, std::string const& oper)
+    {
+        auto& record = this->record(EventRecord::Kind::AsgOper);
+        encodeOper(record, oper);
+        encode(record.to, infoTo);
+        encode(record.from, infoFrom);
+    }
+}
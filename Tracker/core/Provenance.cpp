@@ -0,0 +1,291 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Provenance.cpp
+
+Abstract:
+
+    Append-only graph of object modifications.
+
+Author / Creation date:
+
+    JulesIMF / 16.03.22
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <Tracker.h>
+#include <algorithm>
+#include <set>
+
+//
+// Defines
+//
+
+namespace Tracker
+{
+    int Provenance::append(Node const& node)
+    {
+        auto& history = histories.local();
+        int id = next.fetch_add(1, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(history.mutex);
+        history.entries.push_back({ id, node });
+        trim(history, id + 1);
+        return id;
+    }
+
+    Provenance::Node Provenance::node(int id) const
+    {
+        Node found;
+        if (!find(id, found))
+            return { ModificationType::DTOR, "", -1, -1, -1, -1, 0, {} };
+
+        return found;
+    }
+
+    int Provenance::size() const
+    {
+        return next.load(std::memory_order_relaxed);
+    }
+
+    void Provenance::setCapacity(std::size_t capacity)
+    {
+        this->capacity = capacity;
+
+        int end = size();
+        histories.forEach([&](History& history)
+        {
+            std::lock_guard<std::mutex> lock(history.mutex);
+            trim(history, end);
+        });
+    }
+
+    //
+    // Keeps the nodes among the latest capacity ones before end.
+    // A history trims itself only when its thread appends, find
+    // hides what an idle thread still holds.
+    //
+
+    void Provenance::trim(History& history, int end)
+    {
+        auto capacity = this->capacity.load(std::memory_order_relaxed);
+        if (!capacity)
+            return;
+
+        while (!history.entries.empty() && end - history.entries.front().id > int(capacity))
+            history.entries.pop_front();
+    }
+
+    bool Provenance::find(int id, Node& node) const
+    {
+        auto capacity = this->capacity.load(std::memory_order_relaxed);
+        if (id < 0 || id >= size() || (capacity && size() - id > int(capacity)))
+            return false;
+
+        bool isFound = false;
+        histories.forEach([&](History const& history)
+        {
+            if (isFound)
+                return;
+
+            std::lock_guard<std::mutex> lock(history.mutex);
+            auto found = std::lower_bound(history.entries.begin(), history.entries.end(), id,
+                                          [](Entry const& entry, int id) { return entry.id < id; });
+
+            if (found == history.entries.end() || found->id != id)
+                return;
+
+            node = found->node;
+            isFound = true;
+        });
+
+        return isFound;
+    }
+
+    std::string Provenance::render(int id, std::size_t limit) const
+    {
+        //
+        // Explicit stack instead of recursion: chains
+        // can be far deeper than the call stack
+        //
+
+        struct Piece
+        {
+            int node;
+            char const* text;
+        };
+
+        std::string result;
+        std::vector<Piece> pieces = { { id, nullptr } };
+
+        while (!pieces.empty() && result.size() < limit)
+        {
+            auto piece = pieces.back();
+            pieces.pop_back();
+
+            if (piece.text)
+            {
+                result += piece.text;
+                continue;
+            }
+
+            if (piece.node < 0)
+                continue;
+
+            Node node;
+            if (!find(piece.node, node))
+            {
+                result += "...";
+                continue;
+            }
+
+            switch (node.type)
+            {
+            case ModificationType::CTOR:
+                result += "<id" + std::to_string(node.object) + "|" + node.value.str() + ">";
+                break;
+
+            case ModificationType::CTORCopy:
+                result += "COPY(" + objectName(node.name, node.flags) + ", ";
+                pieces.push_back({ -1, ")" });
+                pieces.push_back({ node.source, nullptr });
+                break;
+
+            case ModificationType::CTORMove:
+                result += "MOVE(" + objectName(node.name, node.flags) + ", ";
+                pieces.push_back({ -1, ")" });
+                pieces.push_back({ node.source, nullptr });
+                break;
+
+            case ModificationType::Asg:
+                result += "ASG(" + node.value.str() + ", ";
+                pieces.push_back({ -1, ")" });
+                pieces.push_back({ node.self, nullptr });
+                break;
+
+            case ModificationType::AsgCopy:
+            case ModificationType::AsgMove:
+            case ModificationType::AsgOper:
+                result += node.type == ModificationType::AsgCopy ? "ASGCOPY(" :
+                          node.type == ModificationType::AsgMove ? "ASGMOVE(" :
+                          "ASG" + std::string(node.oper) + "(";
+                result += objectName(node.name, node.flags) + ", ";
+                pieces.push_back({ -1, ")" });
+                pieces.push_back({ node.self, nullptr });
+                pieces.push_back({ -1, ", " });
+                pieces.push_back({ node.source, nullptr });
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        if (!pieces.empty())
+        {
+            result.resize(limit);
+            result += "...";
+        }
+
+        return result;
+    }
+
+    int Provenance::previous(Node const& node) const
+    {
+        //
+        // The value of an object comes from its source for copies
+        // and moves, and from the object itself for compound assignments
+        //
+
+        switch (node.type)
+        {
+        case ModificationType::CTORCopy:
+        case ModificationType::CTORMove:
+        case ModificationType::AsgCopy:
+        case ModificationType::AsgMove:
+            return node.source;
+
+        case ModificationType::AsgOper:
+            return node.self;
+
+        default:
+            return -1;
+        }
+    }
+
+    int Provenance::origin(int id) const
+    {
+        Node node;
+        if (!find(id, node))
+            return -1;
+
+        for (int next = previous(node); find(next, node); next = previous(node))
+            id = next;
+
+        return id;
+    }
+
+    int Provenance::hops(int id) const
+    {
+        Node node;
+        if (!find(id, node))
+            return 0;
+
+        int n = 0;
+        for (int next = previous(node); find(next, node); next = previous(node))
+            n++;
+
+        return n;
+    }
+
+    std::vector<int> Provenance::roots(int id) const
+    {
+        std::vector<int> result;
+        std::vector<int> stack;
+        std::set<int> visited;
+        Node node;
+
+        if (find(id, node))
+            stack.push_back(id);
+
+        while (!stack.empty())
+        {
+            id = stack.back();
+            stack.pop_back();
+            if (!visited.insert(id).second)
+                continue;
+
+            if (!find(id, node))
+                continue;
+
+            int parents[] = { previous(node),
+                              node.type == ModificationType::AsgOper ? node.source : -1 };
+
+            bool isRoot = true;
+            for (int parent : parents)
+            {
+                Node found;
+                if (!find(parent, found))
+                    continue;
+
+                stack.push_back(parent);
+                isRoot = false;
+            }
+
+            if (isRoot)
+                result.push_back(id);
+        }
+
+        return result;
+    }
+}
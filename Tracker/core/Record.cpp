@@ -0,0 +1,152 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Record.cpp
+
+Abstract:
+
+    Conversion between events and EventRecords.
+
+Author / Creation date:
+
+    JulesIMF / 14.03.22
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <Record.h>
+#include <cstring>
+
+//
+// Defines
+//
+
+namespace Tracker
+{
+    void encode(EventRecord::Object& object, TrackedInfo const& info)
+    {
+        object.id = info.id;
+        object.name = info.name;
+        object.function = info.function;
+        object.history = info.history;
+        object.flags = info.flags;
+        object.type = info.type;
+        object.site = info.site;
+        object.bytes = info.bytes;
+        object.address = info.address;
+        object.value = info.value;
+    }
+
+    static void decode(TrackedInfo& info, EventRecord::Object const& object)
+    {
+        info.id = object.id;
+        info.name = object.name;
+        info.function = object.function;
+        info.history = object.history;
+        info.flags = object.flags;
+        info.type = object.type;
+        info.site = object.site;
+        info.bytes = object.bytes;
+        info.address = object.address;
+        info.value = object.value;
+    }
+
+    void encodeOper(EventRecord& record, std::string const& oper)
+    {
+        strncpy(record.oper, oper.c_str(), sizeof(record.oper) - 1);
+        record.oper[sizeof(record.oper) - 1] = '\0';
+    }
+
+    // ----------------------------------------------------
+
+    void replay(Logger& target, EventRecord const& record)
+    {
+        auto calls = ScopeStack::current;
+        calls->time = record.time;
+
+        if (record.kind == EventRecord::Kind::Function)
+        {
+            target.enterFunction(record.function);
+            calls->push(record.function);
+            return;
+        }
+
+        if (record.kind == EventRecord::Kind::ExitFunction)
+        {
+            calls->pop();
+            target.exitFunction();
+            return;
+        }
+
+        if (record.kind == EventRecord::Kind::Alloc)
+        {
+            target.enterAlloc(record.alloc);
+            if (record.alloc.kind == AllocInfo::Kind::Realloc)
+                calls->open();
+
+            return;
+        }
+
+        if (record.kind == EventRecord::Kind::ExitAlloc)
+        {
+            calls->close();
+            target.exitAlloc(record.alloc);
+            return;
+        }
+
+        TrackedInfo infoTo, infoFrom;
+        decode(infoTo, record.to);
+
+        switch (record.kind)
+        {
+        case EventRecord::Kind::DTOR:
+            target.enterDTOR(infoTo);
+            break;
+
+        case EventRecord::Kind::CTOR:
+            target.enterCTOR(infoTo);
+            break;
+
+        case EventRecord::Kind::CTORCopy:
+            decode(infoFrom, record.from);
+            target.enterCTORCopy(infoTo, infoFrom);
+            break;
+
+        case EventRecord::Kind::CTORMove:
+            decode(infoFrom, record.from);
+            target.enterCTORMove(infoTo, infoFrom);
+            break;
+
+        case EventRecord::Kind::Asg:
+            target.enterAsg(infoTo);
+            break;
+
+        case EventRecord::Kind::AsgCopy:
+            decode(infoFrom, record.from);
+            target.enterAsgCopy(infoTo, infoFrom);
+            break;
+
+        case EventRecord::Kind::AsgMove:
+            decode(infoFrom, record.from);
+            target.enterAsgMove(infoTo, infoFrom);
+            break;
+
+        case EventRecord::Kind::AsgOper:
+            decode(infoFrom, record.from);
+            target.enterAsgOper(infoTo, infoFrom, record.oper);
+            break;
+
+        default:
+            break;
+        }
+    }
+}
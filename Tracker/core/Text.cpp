@@ -24,6 +24,7 @@ Revision History:
 //
 
 #include <Tracker.h>
+#include <cinttypes>
 
 //
 // Defines
@@ -31,37 +32,153 @@ Revision History:
 
 namespace Tracker
 {
-    void TextLogger::enterFunction(std::string name)
+    void TextLogger::enterFunction(int function)
     {
         printAllign();
-        printColor(Color::Default, name + "\n");
+        printColor(Color::Default, functionName(function) + "\n");
         printAllign();
         printColor(Color::Default, "{\n");
-        pushFunction(name);
     }
 
     void TextLogger::exitFunction()
     {
-        Logger::exitFunction();
         printAllign();
         printColor(Color::Default, "}\n");
     }
 
+    void TextLogger::printLane()
+    {
+        static Color const palette[] = 
+        {
+            Color::CyanB,
+            Color::YellowB,
+            Color::GreenB,
+            Color::PurpleB,
+            Color::BlueB,
+            Color::RedB,
+        };
+
+        if (!hasLanes)
+            return;
+
+        printColor(palette[lane % (sizeof(palette) / sizeof(palette[0]))], "T" + std::to_string(lane));
+        printColor(Color::Default, " | ");
+    }
+
     void TextLogger::printInfo(TrackedInfo const& info)
     {
         char hex[17];
-        sprintf(hex, "%08x", info.address);
+        snprintf(hex, sizeof(hex), "%08" PRIxPTR, reinterpret_cast<std::uintptr_t>(info.address));
 
-        printColor(Color::YellowB, "\"" + info.name + "\" ");
+        printColor(Color::YellowB, "\"" + objectName(info) + "\" ");
         printColor(Color::Default, "(id: ");
         printColor(Color::PurpleB, std::to_string(info.id));
-        printColor(Color::Default, ", val: ");
-        printColor(Color::PurpleB, info.value);
+        if (info.value.format)
+        {
+            printColor(Color::Default, ", val: ");
+            printColor(Color::PurpleB, info.value.str());
+        }
+
         printColor(Color::Default, ", addr: ");
         printColor(Color::PurpleB, hex);
         printColor(Color::Default, ")");
     }
 
+    void TextLogger::printSummary()
+    {
+        using Type = ModificationType;
+        static std::size_t const nOffenders = 5;
+
+        auto counters = owner->getCounters();
+        auto total = owner->getTotal();
+        auto assigned = counters.total({ Type::Asg, Type::AsgCopy, Type::AsgMove, Type::AsgOper });
+        auto destroyed = counters.total({ Type::DTOR });
+
+        printColor(Color::Default, "\n\n" + std::to_string(total.obj) + " object" + (total.obj != 1 ? "s" : "") + " created, " +
+                                   std::to_string(total.copy) + " copied, " +
+                                   std::to_string(total.move) + " moved, " +
+                                   std::to_string(assigned) + " assigned, " +
+                                   std::to_string(destroyed) + " destroyed\n");
+
+        auto bytesCopied = counters.bytes({ Type::CTORCopy, Type::AsgCopy });
+        auto bytesMoved = counters.bytes({ Type::CTORMove, Type::AsgMove });
+        if (bytesCopied || bytesMoved)
+            printColor(Color::Default, std::to_string(bytesCopied) + " bytes copied, " + std::to_string(bytesMoved) + " bytes moved\n");
+
+        auto const& allocations = counters.allocations();
+        if (allocations.allocs || allocations.reallocs)
+        {
+            printColor(Color::Default, std::to_string(allocations.allocs + allocations.reallocs) + " allocations (" +
+                                       std::to_string(allocations.bytes) + " bytes), " +
+                                       std::to_string(allocations.reallocs) + " reallocations copied " +
+                                       std::to_string(allocations.copies) + " and moved " +
+                                       std::to_string(allocations.moves) + " elements\n");
+        }
+
+        auto printTop = [&](Color color, std::string const& title, std::vector<Counters::Entry> const& entries, std::string const& (*name)(int))
+        {
+            if (entries.empty())
+                return;
+
+            printColor(Color::Default, "\nTop ");
+            printColor(color, title);
+            printColor(Color::Default, ":\n");
+
+            for (auto const& entry : entries)
+            {
+                char count[32];
+                sprintf(count, "%8llu  ", (unsigned long long)entry.count);
+                printColor(Color::PurpleB, count);
+                printColor(Color::Default, name(entry.id) + "\n");
+            }
+        };
+
+        printTop(Color::RedB, "copies by function", counters.topFunctions({ Type::CTORCopy, Type::AsgCopy }, nOffenders), functionName);
+        printTop(Color::RedB, "copies by type", counters.topTypes({ Type::CTORCopy, Type::AsgCopy }, nOffenders), typeName);
+        printTop(Color::GreenB, "moves by function", counters.topFunctions({ Type::CTORMove, Type::AsgMove }, nOffenders), functionName);
+        printTop(Color::GreenB, "moves by type", counters.topTypes({ Type::CTORMove, Type::AsgMove }, nOffenders), typeName);
+        printTop(Color::RedB, "bytes copied by type", counters.topTypesByBytes({ Type::CTORCopy, Type::AsgCopy }, nOffenders), typeName);
+        printTop(Color::RedB, "copies by line", counters.topSites({ Type::CTORCopy, Type::AsgCopy }, nOffenders), siteName);
+        printTop(Color::GreenB, "moves by line", counters.topSites({ Type::CTORMove, Type::AsgMove }, nOffenders), siteName);
+        printTop(Color::YellowB, "temporaries by line", counters.topTemporarySites(nOffenders), siteName);
+        printTop(Color::RedB, "relocation copies by line", counters.topRelocationSites(nOffenders), siteName);
+
+        //
+        // Wall time next to the copies, a function that copies a lot
+        // matters only if it is where the time goes
+        //
+
+        auto slowest = counters.topFunctionsByTime(nOffenders);
+        if (!slowest.empty())
+        {
+            printColor(Color::Default, "\nTop ");
+            printColor(Color::CyanB, "time by function");
+            printColor(Color::Default, " (self, total, calls, copies):\n");
+
+            for (auto const& entry : slowest)
+            {
+                char times[96];
+                sprintf(times, "%10.3f ms %10.3f ms %8llu %8llu  ",
+                        entry.count / 1e6, counters.inclusiveTime(entry.id) / 1e6,
+                        (unsigned long long)counters.callsOf(entry.id),
+                        (unsigned long long)counters.byFunction(entry.id, { Type::CTORCopy, Type::AsgCopy }));
+                printColor(Color::PurpleB, times);
+                printColor(Color::Default, functionName(entry.id) + "\n");
+            }
+        }
+
+        auto throwing = throwingMoveTypes();
+        if (!throwing.empty())
+        {
+            printColor(Color::Default, "\nTypes with moves that are not ");
+            printColor(Color::RedB, "noexcept");
+            printColor(Color::Default, ":\n");
+
+            for (auto type : throwing)
+                printColor(Color::Default, "          " + typeName(type) + "\n");
+        }
+    }
+
     void TextLogger::enterCTOR(TrackedInfo const& info)
     {
         printAllign();
@@ -128,6 +245,66 @@ namespace Tracker
         printColor(Color::Default, "\n");
     }
 
+    void TextLogger::printBlock(AllocInfo const& info, std::uint32_t count, void* address)
+    {
+        char hex[17];
+        snprintf(hex, sizeof(hex), "%08" PRIxPTR, reinterpret_cast<std::uintptr_t>(address));
+
+        printColor(Color::YellowB, typeName(info.type) + "[" + std::to_string(count) + "] ");
+        printColor(Color::Default, "(");
+        printColor(Color::PurpleB, std::to_string(std::uint64_t(count) * info.size));
+        printColor(Color::Default, " bytes, addr: ");
+        printColor(Color::PurpleB, hex);
+        printColor(Color::Default, ")");
+    }
+
+    void TextLogger::enterAlloc(AllocInfo const& info)
+    {
+        printAllign();
+        switch (info.kind)
+        {
+        case AllocInfo::Kind::Alloc:
+            printColor(Color::CyanB, "ALLOC ");
+            printBlock(info, info.count, info.address);
+            printColor(Color::Default, "\n");
+            break;
+
+        case AllocInfo::Kind::Realloc:
+            printColor(Color::CyanB, "REALLOC ");
+            printBlock(info, info.previousCount, info.previous);
+            printColor(Color::Default, " -> ");
+            printBlock(info, info.count, info.address);
+            printColor(Color::Default, "\n");
+            printAllign();
+            printColor(Color::Default, "{\n");
+            break;
+
+        case AllocInfo::Kind::Free:
+            printColor(Color::CyanB, "FREE ");
+            printBlock(info, info.count, info.address);
+            printColor(Color::Default, "\n");
+            break;
+        }
+    }
+
+    void TextLogger::exitAlloc(AllocInfo const& info)
+    {
+        printAllign();
+        printColor(Color::Default, "} ");
+        printColor(Color::RedB, std::to_string(info.copies) + " copied");
+        printColor(Color::Default, ", ");
+        printColor(Color::GreenB, std::to_string(info.moves) + " moved");
+
+        //
+        // A relocation that copied is worth a line of its own
+        //
+
+        if (info.copies && (info.flags & AllocInfo::ThrowingMove))
+            printColor(Color::RedB, "  <- " + typeName(info.type) + " move constructor is not noexcept");
+
+        printColor(Color::Default, "\n");
+    }
+
     void TextLogger::enterDTOR(TrackedInfo const& info)
     {
         printAllign();
@@ -0,0 +1,655 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Trace.cpp
+
+Abstract:
+
+    Binary event stream (.trk): the writer and the reader
+    that replays it.
+
+Author / Creation date:
+
+    JulesIMF / 01.04.22
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <Colors.h>
+#include <Record.h>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//
+// Defines
+//
+
+namespace Tracker
+{
+    //
+    // A trace is the magic followed by entries, each of them a tag
+    // and a fixed-layout body. Events are tagged with their
+    // EventRecord::Kind, their body starts with their time (u64, ns).
+    // Ids are those of the writing process, the strings come before
+    // the first entry that uses them.
+    //
+    //     String  table (u8), id (i32), length (u32), bytes
+    //     Type    id (i32), traits (u8)
+    //     Lane    lane (i32)
+    //
+
+    static char const magic[8] = { 'T', 'R', 'K', 'T', 'R', 'A', 'C', 'E' };
+
+    enum TraceTag : std::uint8_t
+    {
+        StringTag = 0x40,
+        TypeTag,
+        LaneTag,
+    };
+
+    enum TraceTable : std::uint8_t
+    {
+        FunctionTable,
+        NameTable,
+        TypeTable,
+        SiteTable,
+        nTables,
+    };
+
+    enum TraceTraits : std::uint8_t
+    {
+        Registered              = 1 << 0,
+        NothrowMoveConstructible = 1 << 1,
+        NothrowMoveAssignable    = 1 << 2,
+    };
+
+    struct TraceObject
+    {
+        std::uint64_t address;
+        std::uint64_t value;
+        std::int32_t id;
+        std::int32_t name;
+        std::int32_t function;
+        std::int32_t history;
+        std::uint32_t flags;
+        std::int32_t type;
+        std::int32_t site;
+        std::uint32_t bytes;
+        std::int32_t format; // in formatters, -1 without a value
+        std::uint32_t unused;
+    };
+
+    struct TraceAlloc
+    {
+        std::uint64_t address;
+        std::uint64_t previous;
+        std::int32_t type;
+        std::int32_t site;
+        std::uint32_t size;
+        std::uint32_t count;
+        std::uint32_t previousCount;
+        std::uint32_t copies;
+        std::uint32_t moves;
+        std::uint8_t kind;
+        std::uint8_t flags;
+        std::uint8_t unused[2];
+    };
+
+    static StringTable& table(int index)
+    {
+        switch (index)
+        {
+        case FunctionTable:
+            return functions();
+
+        case NameTable:
+            return names();
+
+        case TypeTable:
+            return types();
+
+        default:
+            return sites();
+        }
+    }
+
+    //
+    // Every formatter capture() can choose, see formatterOf()
+    //
+
+    static TrackedValue::Formatter const formatters[] =
+    {
+        &formatValue<std::int8_t>,
+        &formatValue<std::int16_t>,
+        &formatValue<std::int32_t>,
+        &formatValue<std::int64_t>,
+        &formatValue<std::uint8_t>,
+        &formatValue<std::uint16_t>,
+        &formatValue<std::uint32_t>,
+        &formatValue<std::uint64_t>,
+        &formatValue<float>,
+        &formatValue<double>,
+        &formatValue<void const*>,
+    };
+
+    static int const nFormatters = sizeof(formatters) / sizeof(formatters[0]);
+
+    static int formatIndex(TrackedValue::Formatter format)
+    {
+        for (int i = 0; i != nFormatters; i++)
+            if (formatters[i] == format)
+                return i;
+
+        return -1;
+    }
+
+    // ----------------------------------------------------
+
+    TraceLogger::TraceLogger(char const* filename)
+    {
+        file = fopen(filename, "wb");
+        if (file == nullptr)
+            throw std::runtime_error(std::string("cant open \"") + filename + "\"");
+
+        buffer.reserve(bufferSize + 4096);
+        put(magic, sizeof(magic));
+    }
+
+    TraceLogger::~TraceLogger()
+    {
+        flush();
+        fclose(file);
+    }
+
+    void TraceLogger::put(void const* data, std::size_t size)
+    {
+        buffer.append(static_cast<char const*>(data), size);
+        if (buffer.size() >= bufferSize)
+            flush();
+    }
+
+    void TraceLogger::flush()
+    {
+        fwrite(buffer.data(), 1, buffer.size(), file);
+        buffer.clear();
+    }
+
+    void TraceLogger::reference(int index, int id)
+    {
+        for (; known[index] <= id; known[index]++)
+        {
+            auto const& name = table(index).name(known[index]);
+            std::uint8_t tag = StringTag;
+            std::uint8_t tableIndex = index;
+            std::int32_t stringId = known[index];
+            std::uint32_t length = name.size();
+
+            put(&tag, sizeof(tag));
+            put(&tableIndex, sizeof(tableIndex));
+            put(&stringId, sizeof(stringId));
+            put(&length, sizeof(length));
+            put(name.data(), length);
+
+            if (index != TypeTable)
+                continue;
+
+            auto traits = typeTraits(stringId);
+            std::uint8_t flags = (traits.isRegistered ? Registered : 0) |
+                                 (traits.isNothrowMoveConstructible ? NothrowMoveConstructible : 0) |
+                                 (traits.isNothrowMoveAssignable ? NothrowMoveAssignable : 0);
+
+            tag = TypeTag;
+            put(&tag, sizeof(tag));
+            put(&stringId, sizeof(stringId));
+            put(&flags, sizeof(flags));
+        }
+    }
+
+    void TraceLogger::reference(TrackedInfo const& info)
+    {
+        if (!info.isTemp())
+            reference(NameTable, info.name);
+
+        reference(FunctionTable, info.function);
+        reference(TypeTable, info.type);
+        reference(SiteTable, info.site);
+    }
+
+    void TraceLogger::putTag(EventRecord::Kind kind)
+    {
+        auto tag = static_cast<std::uint8_t>(kind);
+        std::uint64_t time = eventTime();
+        put(&tag, sizeof(tag));
+        put(&time, sizeof(time));
+    }
+
+    static TraceObject encodeObject(TrackedInfo const& info)
+    {
+        TraceObject object = {};
+        object.address = reinterpret_cast<std::uintptr_t>(info.address);
+        object.value = info.value.bits;
+        object.id = info.id;
+        object.name = info.name;
+        object.function = info.function;
+        object.history = info.history;
+        object.flags = info.flags;
+        object.type = info.type;
+        object.site = info.site;
+        object.bytes = info.bytes;
+        object.format = info.value.format ? formatIndex(info.value.format) : -1;
+        return object;
+    }
+
+    void TraceLogger::putEvent(EventRecord::Kind kind, TrackedInfo const& infoTo, TrackedInfo const* infoFrom, std::string const& oper)
+    {
+        reference(infoTo);
+        if (infoFrom)
+            reference(*infoFrom);
+
+        auto to = encodeObject(infoTo);
+        putTag(kind);
+        put(&to, sizeof(to));
+
+        if (infoFrom)
+        {
+            auto from = encodeObject(*infoFrom);
+            put(&from, sizeof(from));
+        }
+
+        if (kind == EventRecord::Kind::AsgOper)
+        {
+            EventRecord record;
+            encodeOper(record, oper);
+            put(record.oper, sizeof(record.oper));
+        }
+    }
+
+    void TraceLogger::putAlloc(EventRecord::Kind kind, AllocInfo const& info)
+    {
+        reference(TypeTable, info.type);
+        reference(SiteTable, info.site);
+
+        TraceAlloc alloc = {};
+        alloc.address = reinterpret_cast<std::uintptr_t>(info.address);
+        alloc.previous = reinterpret_cast<std::uintptr_t>(info.previous);
+        alloc.type = info.type;
+        alloc.site = info.site;
+        alloc.size = info.size;
+        alloc.count = info.count;
+        alloc.previousCount = info.previousCount;
+        alloc.copies = info.copies;
+        alloc.moves = info.moves;
+        alloc.kind = static_cast<std::uint8_t>(info.kind);
+        alloc.flags = info.flags;
+
+        putTag(kind);
+        put(&alloc, sizeof(alloc));
+    }
+
+    // ----------------------------------------------------
+
+    void TraceLogger::enterFunction(int function)
+    {
+        reference(FunctionTable, function);
+
+        std::int32_t id = function;
+        putTag(EventRecord::Kind::Function);
+        put(&id, sizeof(id));
+    }
+
+    void TraceLogger::exitFunction()
+    {
+        putTag(EventRecord::Kind::ExitFunction);
+    }
+
+    void TraceLogger::enterLane(int lane)
+    {
+        Logger::enterLane(lane);
+
+        std::uint8_t tag = LaneTag;
+        std::int32_t id = lane;
+        put(&tag, sizeof(tag));
+        put(&id, sizeof(id));
+    }
+
+    void TraceLogger::enterDTOR(TrackedInfo const& info)
+    {
+        putEvent(EventRecord::Kind::DTOR, info);
+    }
+
+    void TraceLogger::enterCTOR(TrackedInfo const& info)
+    {
+        putEvent(EventRecord::Kind::CTOR, info);
+    }
+
+    void TraceLogger::enterCTORCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+    {
+        putEvent(EventRecord::Kind::CTORCopy, infoTo, &infoFrom);
+    }
+
+    void TraceLogger::enterCTORMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+    {
+        putEvent(EventRecord::Kind::CTORMove, infoTo, &infoFrom);
+    }
+
+    void TraceLogger::enterAsg(TrackedInfo const& info)
+    {
+        putEvent(EventRecord::Kind::Asg, info);
+    }
+
+    void TraceLogger::enterAsgCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+    {
+        putEvent(EventRecord::Kind::AsgCopy, infoTo, &infoFrom);
+    }
+
+    void TraceLogger::enterAsgMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+    {
+        putEvent(EventRecord::Kind::AsgMove, infoTo, &infoFrom);
+    }
+
+    void TraceLogger::enterAsgOper(TrackedInfo const& infoTo, TrackedInfo const& infoFrom, std::string const& oper)
+    {
+        putEvent(EventRecord::Kind::AsgOper, infoTo, &infoFrom, oper);
+    }
+
+    void TraceLogger::enterAlloc(AllocInfo const& info)
+    {
+        putAlloc(EventRecord::Kind::Alloc, info);
+    }
+
+    void TraceLogger::exitAlloc(AllocInfo const& info)
+    {
+        putAlloc(EventRecord::Kind::ExitAlloc, info);
+    }
+
+    // ----------------------------------------------------
+
+    TraceReader::TraceReader(char const* filename) :
+        filename(filename),
+        data(nullptr),
+        size(0)
+    {
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error(std::string("cant open \"") + filename + "\"");
+
+        struct stat info;
+        if (fstat(fd, &info) == 0)
+            size = info.st_size;
+
+        void* mapped = size < sizeof(magic) ? MAP_FAILED : mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if (mapped == MAP_FAILED || memcmp(mapped, magic, sizeof(magic)))
+        {
+            if (mapped != MAP_FAILED)
+                munmap(mapped, size);
+
+            throw std::runtime_error(std::string("\"") + filename + "\" is not a tracker trace");
+        }
+
+        madvise(mapped, size, MADV_SEQUENTIAL);
+        data = static_cast<char const*>(mapped);
+    }
+
+    TraceReader::~TraceReader()
+    {
+        munmap(const_cast<char*>(data), size);
+    }
+
+    int TraceReader::local(int index, int id) const
+    {
+        if (id < 0 || std::size_t(id) >= ids[index].size())
+            return -1;
+
+        return ids[index][id];
+    }
+
+    static ModificationType modificationType(EventRecord::Kind kind)
+    {
+        switch (kind)
+        {
+        case EventRecord::Kind::DTOR:
+            return ModificationType::DTOR;
+
+        case EventRecord::Kind::CTOR:
+            return ModificationType::CTOR;
+
+        case EventRecord::Kind::CTORCopy:
+            return ModificationType::CTORCopy;
+
+        case EventRecord::Kind::CTORMove:
+            return ModificationType::CTORMove;
+
+        case EventRecord::Kind::Asg:
+            return ModificationType::Asg;
+
+        case EventRecord::Kind::AsgCopy:
+            return ModificationType::AsgCopy;
+
+        case EventRecord::Kind::AsgMove:
+            return ModificationType::AsgMove;
+
+        default:
+            return ModificationType::AsgOper;
+        }
+    }
+
+    std::size_t TraceReader::replay(Logger& target)
+    {
+        target.attach(this);
+
+        auto calls = ScopeStack::current;
+        std::map<int, ScopeStack> lanes;
+        ScopeStack::current = &lanes[0];
+
+        auto& counters = threads.local().counters;
+        std::map<int, ScopeTimer> timers;
+        auto timer = &timers[0];
+        std::size_t position = sizeof(magic);
+        std::size_t whole = position;
+        std::size_t nEvents = 0;
+
+        //
+        // Reads the next body, false where the trace was cut short
+        //
+
+        auto read = [&](void* to, std::size_t length)
+        {
+            if (size - position < length)
+                return false;
+
+            memcpy(to, data + position, length);
+            position += length;
+            return true;
+        };
+
+        auto object = [&](EventRecord::Object& to)
+        {
+            TraceObject from;
+            if (!read(&from, sizeof(from)))
+                return false;
+
+            to.id = from.id;
+            to.name = from.flags & TrackedInfo::Temp ? from.name : local(NameTable, from.name);
+            to.function = local(FunctionTable, from.function);
+            to.history = from.history;
+            to.flags = from.flags;
+            to.type = local(TypeTable, from.type);
+            to.site = local(SiteTable, from.site);
+            to.bytes = from.bytes;
+            to.address = reinterpret_cast<void*>(std::uintptr_t(from.address));
+            to.value.bits = from.value;
+            to.value.format = from.format >= 0 && from.format < nFormatters ? formatters[from.format] : nullptr;
+            return true;
+        };
+
+        auto alloc = [&](AllocInfo& to)
+        {
+            TraceAlloc from;
+            if (!read(&from, sizeof(from)))
+                return false;
+
+            to.kind = static_cast<AllocInfo::Kind>(from.kind);
+            to.flags = from.flags;
+            to.type = local(TypeTable, from.type);
+            to.site = local(SiteTable, from.site);
+            to.size = from.size;
+            to.count = from.count;
+            to.previousCount = from.previousCount;
+            to.copies = from.copies;
+            to.moves = from.moves;
+            to.address = reinterpret_cast<void*>(std::uintptr_t(from.address));
+            to.previous = reinterpret_cast<void*>(std::uintptr_t(from.previous));
+            return true;
+        };
+
+        std::uint8_t tag = 0;
+        while (read(&tag, sizeof(tag)))
+        {
+            if (tag == StringTag)
+            {
+                std::uint8_t index = 0;
+                std::int32_t id = 0;
+                std::uint32_t length = 0;
+                if (!read(&index, sizeof(index)) || !read(&id, sizeof(id)) || !read(&length, sizeof(length)) ||
+                    index >= nTables || id < 0 || size - position < length)
+                    break;
+
+                if (ids[index].size() <= std::size_t(id))
+                    ids[index].resize(id + 1, -1);
+
+                ids[index][id] = table(index).intern(std::string(data + position, length));
+                position += length;
+                whole = position;
+                continue;
+            }
+
+            if (tag == TypeTag)
+            {
+                std::int32_t id = 0;
+                std::uint8_t flags = 0;
+                if (!read(&id, sizeof(id)) || !read(&flags, sizeof(flags)))
+                    break;
+
+                if (flags & Registered)
+                    registerType(local(TypeTable, id), { true,
+                                                     bool(flags & NothrowMoveConstructible),
+                                                     bool(flags & NothrowMoveAssignable) });
+                whole = position;
+                continue;
+            }
+
+            if (tag == LaneTag)
+            {
+                std::int32_t lane = 0;
+                if (!read(&lane, sizeof(lane)))
+                    break;
+
+                ScopeStack::current = &lanes[lane];
+                timer = &timers[lane];
+                target.enterLane(lane);
+                whole = position;
+                continue;
+            }
+
+            EventRecord record;
+            record.kind = static_cast<EventRecord::Kind>(tag);
+            if (!read(&record.time, sizeof(record.time)))
+                break;
+
+            bool isWhole = true;
+
+            switch (record.kind)
+            {
+            case EventRecord::Kind::Function:
+            {
+                std::int32_t function = 0;
+                isWhole = read(&function, sizeof(function));
+                record.function = local(FunctionTable, function);
+                if (isWhole)
+                    timer->enter(record.time);
+
+                break;
+            }
+
+            case EventRecord::Kind::ExitFunction:
+                timer->exit(counters, ScopeStack::current->top(), record.time);
+                break;
+
+            case EventRecord::Kind::Alloc:
+                isWhole = alloc(record.alloc);
+                if (isWhole)
+                    counters.addAlloc(record.alloc);
+
+                break;
+
+            case EventRecord::Kind::ExitAlloc:
+                isWhole = alloc(record.alloc);
+                if (isWhole)
+                    counters.addRealloc(record.alloc);
+
+                break;
+
+            case EventRecord::Kind::DTOR:
+            case EventRecord::Kind::CTOR:
+            case EventRecord::Kind::Asg:
+                isWhole = object(record.to);
+                break;
+
+            case EventRecord::Kind::CTORCopy:
+            case EventRecord::Kind::CTORMove:
+            case EventRecord::Kind::AsgCopy:
+            case EventRecord::Kind::AsgMove:
+                isWhole = object(record.to) && object(record.from);
+                break;
+
+            case EventRecord::Kind::AsgOper:
+                isWhole = object(record.to) && object(record.from) && read(record.oper, sizeof(record.oper));
+                record.oper[sizeof(record.oper) - 1] = '\0';
+                break;
+
+            default:
+                isWhole = false;
+                break;
+            }
+
+            if (!isWhole)
+                break;
+
+            if (record.kind >= EventRecord::Kind::DTOR && record.kind <= EventRecord::Kind::AsgOper)
+            {
+                TrackedInfo info;
+                info.flags = record.to.flags;
+                info.type = record.to.type;
+                info.site = record.to.site;
+                info.bytes = record.to.bytes;
+                counters.add(modificationType(record.kind), info, ScopeStack::current->top());
+            }
+
+            Tracker::replay(target, record);
+            whole = position;
+            nEvents++;
+        }
+
+        if (whole != size)
+            fprintf(stderr, "%sTraceReader: %s\"%s\" is cut short, replayed up to byte %zu of %zu\n",
+                    TerminalColor::PurpleB, TerminalColor::Default, filename.c_str(), whole, size);
+
+        ScopeStack::current = calls;
+        return nEvents;
+    }
+}
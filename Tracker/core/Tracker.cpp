@@ -25,6 +25,8 @@ Revision History:
 
 #define TRACKER_CPP
 #include <Tracker.h>
+#include <Colors.h>
+#include <unordered_map>
 
 //
 // Defines
@@ -32,178 +34,539 @@ Revision History:
 
 namespace Tracker
 {
-    void Logger::exitFunction()
+    int StringTable::intern(std::string const& name)
     {
-        calls.pop();
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = ids.find(name);
+        if (it == ids.end())
+        {
+            it = ids.emplace(name, names.size()).first;
+            names.push_back(name);
+        }
+
+        return it->second;
+    }
+
+    std::string const& StringTable::name(int id) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return names[id];
+    }
+
+    // ----------------------------------------------------
+
+    //
+    // Tables are never destroyed: loggers replay
+    // events during static destruction
+    //
+
+    StringTable& functions()
+    {
+        static auto table = new StringTable;
+        return *table;
+    }
+
+    StringTable& names()
+    {
+        static auto table = new StringTable;
+        return *table;
+    }
+
+    StringTable& types()
+    {
+        static auto table = new StringTable;
+        return *table;
+    }
+
+    StringTable& sites()
+    {
+        static auto table = new StringTable;
+        return *table;
+    }
+
+    int internFunction(char const* name)
+    {
+        return functions().intern(name);
     }
 
-    void Logger::pushFunction(std::string const& name)
+    int internType(char const* signature)
     {
-        calls.push(name);
+        //
+        // "int Tracker::typeId() [with T = Int]" for gcc,
+        // "int Tracker::typeId() [T = Int]" for clang
+        //
+
+        std::string name = signature;
+        auto begin = name.find("T = ");
+        if (begin == std::string::npos)
+            return types().intern(name);
+
+        begin += 4;
+        auto end = name.find_first_of(";]", begin);
+        return types().intern(name.substr(begin, end - begin));
     }
 
+    //
+    // Lines of the standard library say nothing about the program
+    //
+
+    static bool isSystemHeader(char const* file)
+    {
+        return strncmp(file, "/usr/include/", 13) == 0 ||
+               strncmp(file, "/usr/local/include/", 19) == 0 ||
+               strstr(file, "/include/c++/") != nullptr;
+    }
+
+    int internSite(char const* file, int line)
+    {
+        //
+        // Called on every tracked construction: the per-thread cache
+        // is keyed by the literal's address and skips formatting
+        //
+
+        struct Key
+        {
+            char const* file;
+            int line;
+
+            bool operator==(Key const& other) const
+            {
+                return file == other.file && line == other.line;
+            }
+        };
+
+        struct Hash
+        {
+            std::size_t operator()(Key const& key) const
+            {
+                return std::hash<char const*>()(key.file) * 31 + key.line;
+            }
+        };
+
+        thread_local std::unordered_map<Key, int, Hash> cache;
+
+        auto it = cache.find({ file, line });
+        if (it != cache.end())
+            return it->second;
+
+        int id = isSystemHeader(file) ? -1 : sites().intern(std::string(file) + ":" + std::to_string(line));
+        cache.emplace(Key{ file, line }, id);
+        return id;
+    }
+
+    // ----------------------------------------------------
+
+    static std::mutex traitsMutex;
+    static std::vector<TypeTraits>* traits = new std::vector<TypeTraits>;
+
+    int registerType(int type, TypeTraits const& typeTraits)
+    {
+        std::lock_guard<std::mutex> lock(traitsMutex);
+        if (traits->size() <= std::size_t(type))
+            traits->resize(type + 1);
+
+        (*traits)[type] = typeTraits;
+
+        if (!typeTraits.isNothrowMoveConstructible || !typeTraits.isNothrowMoveAssignable)
+        {
+            fprintf(stderr, "%sTracker: %s%s has a %s that is not noexcept, "
+                            "std containers will copy it when they relocate%s\n",
+                    TerminalColor::RedB, TerminalColor::Default, typeName(type).c_str(),
+                    typeTraits.isNothrowMoveConstructible ? "move assignment" : "move constructor",
+                    TerminalColor::Default);
+        }
+
+        return type;
+    }
+
+    TypeTraits typeTraits(int type)
+    {
+        std::lock_guard<std::mutex> lock(traitsMutex);
+        if (type < 0 || traits->size() <= std::size_t(type))
+            return {};
+
+        return (*traits)[type];
+    }
+
+    std::vector<int> throwingMoveTypes()
+    {
+        std::lock_guard<std::mutex> lock(traitsMutex);
+        std::vector<int> result;
+        for (std::size_t type = 0; type != traits->size(); type++)
+        {
+            auto const& entry = (*traits)[type];
+            if (entry.isRegistered && (!entry.isNothrowMoveConstructible || !entry.isNothrowMoveAssignable))
+                result.push_back(type);
+        }
+
+        return result;
+    }
+
+    // ----------------------------------------------------
+
+    std::string const& functionName(int id)
+    {
+        static std::string const unknown = "???";
+        return id < 0 ? unknown : functions().name(id);
+    }
+
+    std::string const& typeName(int id)
+    {
+        static std::string const unknown = "???";
+        return id < 0 ? unknown : types().name(id);
+    }
+
+    std::string const& siteName(int id)
+    {
+        static std::string const unknown = "???";
+        return id < 0 ? unknown : sites().name(id);
+    }
+
+    std::string objectName(int name, std::uint32_t flags)
+    {
+        if (flags & TrackedInfo::Temp)
+            return "tmp" + std::to_string(name);
+
+        return name < 0 ? "???" : names().name(name);
+    }
+
+    std::string objectName(TrackedInfo const& info)
+    {
+        return objectName(info.name, info.flags);
+    }
+
+    // ----------------------------------------------------
+
     int Logger::depth()
     {
-        return calls.size();
+        return ScopeStack::current ? ScopeStack::current->depth() : 0;
+    }
+
+    std::uint64_t Logger::eventTime()
+    {
+        auto time = ScopeStack::current ? ScopeStack::current->time : 0;
+        return time ? time : timestamp();
+    }
+
+    void Logger::enterAlloc(AllocInfo const&)
+    {
+    }
+
+    void Logger::exitAlloc(AllocInfo const&)
+    {
+    }
+
+    void Logger::enterLane(int lane)
+    {
+        this->lane = lane;
+        hasLanes = true;
+    }
+
+    void Logger::attach(MainLoggerBase const* owner)
+    {
+        this->owner = owner;
     }
 
     // ----------------------------------------------------
 
-    void MainLogger::addNewLogger(Logger* logger)
+    std::string TrackedValue::str() const
     {
-        loggers.push_back(logger);
+        if (format == nullptr)
+            return "?";
+
+        char buffer[32];
+        format(buffer, sizeof(buffer), bits);
+        return buffer;
+    }
+
+    // ----------------------------------------------------
+
+    Sampling& Sampling::onlyType(std::string const& name)
+    {
+        types.insert(Tracker::types().intern(name));
+        return *this;
+    }
+
+    Sampling& Sampling::onlyFunction(std::string const& name)
+    {
+        functions.insert(Tracker::functions().intern(name));
+        return *this;
+    }
+
+    bool Sampling::isActive() const
+    {
+        return every > 1 || !types.empty() || !functions.empty();
+    }
+
+    // ----------------------------------------------------
+
+    void MainLoggerBase::setSampling(Sampling const& sampling)
+    {
+        this->sampling = sampling;
+        isSampling = sampling.isActive();
     }
 
-    void MainLogger::setName(TrackedInfo& info, std::string const& name)
+    bool MainLoggerBase::sample(TrackedInfo const& info) const
+    {
+        if (!sampling.types.empty() && !sampling.types.count(info.type))
+            return false;
+
+        if (!sampling.functions.empty() && !sampling.functions.count(info.function))
+            return false;
+
+        if (sampling.every <= 1)
+            return true;
+
+        //
+        // splitmix64 finalizer: neighbouring ids land far apart
+        //
+
+        std::uint64_t x = std::uint64_t(info.id) + sampling.seed + 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        x = x ^ (x >> 31);
+        return x % sampling.every == 0;
+    }
+
+    void MainLoggerBase::setName(TrackedInfo& info, char const* name, int type)
     {
         info.id = getId();
+        info.type = type;
 
-        if (name == "")
+        if (*name == '\0')
         {
-            info.name = "tmp";
-            info.name += std::to_string(++tmpCounter);
-            info.isTemp = true;
+            info.name = tmpCounter.fetch_add(1, std::memory_order_relaxed) + 1;
+            info.flags |= TrackedInfo::Temp;
         }
 
         else
-            info.name = name;
+            info.name = names().intern(name);
         
-        info.function = calls.size() ? calls.top() : "???";
+        info.function = threads.local().calls.top();
+
+        if (!isSampling || sample(info))
+            info.flags |= TrackedInfo::Sampled;
+    }
+
+    //
+    // An object made while tracking was off has no id. It is named as
+    // a temporary on its first event, as the object modified or as the
+    // source; sinks see it from there on. The caller captures its value.
+    //
+
+    bool MainLoggerBase::adopt(TrackedInfo& info, void const* address, int type)
+    {
+        if (info.id >= 0)
+            return false;
+
+        setName(info, "", type);
+        info.address = const_cast<void*>(address);
+        return true;
     }
 
-    void MainLogger::setHistory(ModificationType type, TrackedInfo& info, TrackedInfo const* other, std::string const& oper)
+    void MainLoggerBase::setHistory(ModificationType type, TrackedInfo& info, TrackedInfo const* other, std::string const& oper)
     {
+        Provenance::Node node = { type, "", info.id, -1, -1, -1, 0, {} };
+
         switch (type)
         {
         case ModificationType::CTOR:
-            info.history = "<id" + std::to_string(info.id) + "|" + info.value + ">";
+            node.value = info.value;
             break;
         
         case ModificationType::CTORCopy:
-            info.history = "COPY(" + other->name + ", " + other->history + ")";
-            break;
-        
         case ModificationType::CTORMove:
-            info.history = "MOVE(" + other->name + ", " + other->history + ")";
+            node.source = other->history;
+            node.name = other->name;
+            node.flags = other->flags;
             break;
         
         case ModificationType::Asg:
-            info.history = "ASG(" + info.value + ", " + info.history + ")";
+            node.self = info.history;
+            node.value = info.value;
             break;
 
         case ModificationType::AsgCopy:
-            info.history = "ASGCOPY(" + other->name + ", " + other->history + ", " + info.history + ")";
-            break;
-
         case ModificationType::AsgMove:
-            info.history = "ASGMOVE(" + other->name + ", " + other->history + ", " + info.history + ")";
-            break;
-        
         case ModificationType::AsgOper:
-            info.history = "ASG" + oper + "(" + other->name + ", " + other->history + ", " + info.history + ")";
+            node.self = info.history;
+            node.source = other->history;
+            node.name = other->name;
+            node.flags = other->flags;
+            oper.copy(node.oper, sizeof(node.oper) - 1);
             break;
         
         default:
-            break;
+            return;
         }
+
+        if (other && other->isSampled())
+            info.flags |= TrackedInfo::Sampled;
+
+        info.history = provenance.append(node);
     }
 
-    int MainLogger::getId()
+    std::string MainLoggerBase::history(TrackedInfo const& info) const
     {
-        return currentId++;
+        return provenance.render(info.history);
     }
 
-    void MainLogger::on()
+    int MainLoggerBase::getId()
+    {
+        return currentId.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void MainLoggerBase::on()
     {
         isOn = true;
     }
 
-    void MainLogger::off()
+    void MainLoggerBase::off()
     {
         isOn = false;
     }
 
-    void MainLogger::enterFunction(std::string name)
+    MainLoggerBase::Totals MainLoggerBase::getTotal() const
     {
-        Logger::pushFunction(name);
-        for (auto logger : loggers)
+        using Type = ModificationType;
+        auto counters = getCounters();
+
+        Totals total;
+        total.obj = counters.total({ Type::CTOR, Type::CTORCopy, Type::CTORMove });
+        total.copy = counters.total({ Type::CTORCopy, Type::AsgCopy });
+        total.move = counters.total({ Type::CTORMove, Type::AsgMove });
+        return total;
+    }
+
+    int MainLoggerBase::scopeSite()
+    {
+        auto const& sites = threads.local().sites;
+        return sites.empty() ? -1 : sites.back();
+    }
+
+    //
+    // Innermost site in user code: the TRACKER_CALL around the
+    // container, else the enclosing TRACKER_ENTER
+    //
+
+    int MainLoggerBase::callSite()
+    {
+        return CallSite::current >= 0 ? CallSite::current : scopeSite();
+    }
+
+    int MainLoggerBase::callSite(Site const& site)
+    {
+        auto id = site.id();
+        return id >= 0 ? id : callSite();
+    }
+
+    Counters MainLoggerBase::getCounters() const
+    {
+        Counters counters;
+        threads.forEach([&](ThreadState const& thread)
         {
-            logger->enterFunction(name);
-        }
+            counters.merge(thread.counters);
+        });
+
+        return counters;
+    }
+
+
+    // ----------------------------------------------------
+
+    void DynamicLogger::addNewLogger(Logger* logger)
+    {
+        logger->attach(owner);
+        loggers.push_back(logger);
     }
 
-    void MainLogger::exitFunction()
+    void DynamicLogger::attach(MainLoggerBase const* owner)
+    {
+        Logger::attach(owner);
+        for (auto logger : loggers)
+            logger->attach(owner);
+    }
+
+    void DynamicLogger::enterLane(int lane)
+    {
+        Logger::enterLane(lane);
+        for (auto logger : loggers)
+            logger->enterLane(lane);
+    }
+
+    void DynamicLogger::enterFunction(int function)
+    {
+        for (auto logger : loggers)
+            logger->enterFunction(function);
+    }
+
+    void DynamicLogger::exitFunction()
     {
-        Logger::exitFunction();
         for (auto logger : loggers)
             logger->exitFunction();
     }
 
-    void MainLogger::enterDTOR(TrackedInfo const& info)
+    void DynamicLogger::enterDTOR(TrackedInfo const& info)
     {
-        if (!isOn) return;
-        if (!isOn) return;
         for (auto logger : loggers)
             logger->enterDTOR(info);
     }
 
-    void MainLogger::enterCTOR(TrackedInfo const& info)
+    void DynamicLogger::enterCTOR(TrackedInfo const& info)
     {
-        if (!isOn) return;
-        total.obj++;
         for (auto logger : loggers)
             logger->enterCTOR(info);
     }
 
-    void MainLogger::enterCTORCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+    void DynamicLogger::enterCTORCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
     {
-        if (!isOn) return;
-        total.obj++;
-        total.copy++;
         for (auto logger : loggers)
             logger->enterCTORCopy(infoTo, infoFrom);
     }
 
-    void MainLogger::enterCTORMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+    void DynamicLogger::enterCTORMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
     {
-        if (!isOn) return;
-        total.obj++;
-        total.move++;
         for (auto logger : loggers)
             logger->enterCTORMove(infoTo, infoFrom);
     }
 
-    void MainLogger::enterAsg(TrackedInfo const& info)
+    void DynamicLogger::enterAsg(TrackedInfo const& info)
     {
-        if (!isOn) return;
         for (auto logger : loggers)
             logger->enterAsg(info);
     }
 
-    void MainLogger::enterAsgCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+    void DynamicLogger::enterAsgCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
     {
-        if (!isOn) return;
-        total.copy++;
         for (auto logger : loggers)
             logger->enterAsgCopy(infoTo, infoFrom);
     }
 
-    void MainLogger::enterAsgMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+    void DynamicLogger::enterAsgMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
     {
-        if (!isOn) return;
-        total.move++;
         for (auto logger : loggers)
             logger->enterAsgMove(infoTo, infoFrom);
     }
     
-    void MainLogger::enterAsgOper(TrackedInfo const& infoTo, TrackedInfo const& infoFrom, std::string const& oper) 
+    void DynamicLogger::enterAsgOper(TrackedInfo const& infoTo, TrackedInfo const& infoFrom, std::string const& oper) 
     {
-        if (!isOn) return;
         for (auto logger : loggers) 
             logger->enterAsgOper(infoTo, infoFrom, oper);
     }
 
-    MainLogger::~MainLogger()
+    void DynamicLogger::enterAlloc(AllocInfo const& info)
+    {
+        for (auto logger : loggers)
+            logger->enterAlloc(info);
+    }
+
+    void DynamicLogger::exitAlloc(AllocInfo const& info)
+    {
+        for (auto logger : loggers)
+            logger->exitAlloc(info);
+    }
+
+    DynamicLogger::~DynamicLogger()
     {
         for (auto logger : loggers)
             delete logger;
@@ -211,5 +574,12 @@ namespace Tracker
 
     // ----------------------------------------------------
 
+    void MainLogger::addNewLogger(Logger* logger)
+    {
+        sink<DynamicLogger>().addNewLogger(logger);
+    }
+
+    // ----------------------------------------------------
+
     MainLogger mainLogger;
 }
\ No newline at end of file
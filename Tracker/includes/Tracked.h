@@ -0,0 +1,276 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Tracked.h
+
+Abstract:
+
+    Wrapper that tracks the special members of an arbitrary type
+    and the bytes its copies and moves carry.
+
+Author / Creation date:
+
+    JulesIMF / 23.03.22
+
+Revision History:
+
+--*/
+
+#ifndef TRACKER_TRACKED
+#define TRACKER_TRACKED
+
+//
+// Includes / usings
+//
+
+#include <Tracker.h>
+
+//
+// Defines
+//
+
+namespace Tracker
+{
+    //
+    // Bytes owned by a value: sizeof plus what it keeps on the heap.
+    // Specialize for own types, the fallback is sizeof alone.
+    //
+
+    template <typename T, typename = void>
+    struct Footprint
+    {
+        static std::size_t size(T const&)
+        {
+            return sizeof(T);
+        }
+    };
+
+    template <typename Char, typename Traits, typename Allocator>
+    struct Footprint<std::basic_string<Char, Traits, Allocator>>
+    {
+        static std::size_t size(std::basic_string<Char, Traits, Allocator> const& string)
+        {
+            //
+            // Short strings live inside the object
+            //
+
+            auto data = reinterpret_cast<char const*>(string.data());
+            auto self = reinterpret_cast<char const*>(&string);
+            if (data >= self && data < self + sizeof(string))
+                return sizeof(string);
+
+            return sizeof(string) + (string.capacity() + 1) * sizeof(Char);
+        }
+    };
+
+    template <typename U, typename Allocator>
+    struct Footprint<std::vector<U, Allocator>>
+    {
+        static std::size_t size(std::vector<U, Allocator> const& vector)
+        {
+            std::size_t result = sizeof(vector) + vector.capacity() * sizeof(U);
+            for (auto const& element : vector)
+                result += Footprint<U>::size(element) - sizeof(U);
+
+            return result;
+        }
+    };
+
+    template <typename T>
+    std::uint32_t footprint(T const& value)
+    {
+        auto size = Footprint<T>::size(value);
+        return size > UINT32_MAX ? UINT32_MAX : size;
+    }
+
+    //
+    // T with every special member reported to the dispatcher. The name
+    // and call site are trailing arguments, as in Int.
+    //
+
+    template <typename T>
+    struct Tracked
+    {
+        Tracked(TRACKER_SITE) :
+            value()
+        {
+            TRACKER_IF(COPIES)
+                enter(ModificationType::CTOR, "", site);
+        }
+
+        Tracked(T const& value, char const* name = "", TRACKER_SITE) :
+            value(value)
+        {
+            TRACKER_IF(COPIES)
+                enter(ModificationType::CTOR, name, site);
+        }
+
+        Tracked(T&& value, char const* name = "", TRACKER_SITE) :
+            value(std::move(value))
+        {
+            TRACKER_IF(COPIES)
+                enter(ModificationType::CTOR, name, site);
+        }
+
+        Tracked(Tracked const& other, char const* name = "", TRACKER_SITE) :
+            value(other.value)
+        {
+            TRACKER_IF(COPIES)
+                enter(ModificationType::CTORCopy, name, site, &other);
+        }
+
+        Tracked(Tracked&& other, char const* name = "", TRACKER_SITE) noexcept(std::is_nothrow_move_constructible_v<T>) :
+            value(std::move(other.value))
+        {
+            TRACKER_IF(COPIES)
+                enter(ModificationType::CTORMove, name, site, &other);
+        }
+
+        Tracked& operator=(T const& value)
+        {
+            this->value = value;
+            TRACKER_IF(ASSIGNMENTS)
+                assign(ModificationType::Asg);
+
+            return *this;
+        }
+
+        Tracked& operator=(T&& value)
+        {
+            this->value = std::move(value);
+            TRACKER_IF(ASSIGNMENTS)
+                assign(ModificationType::Asg);
+
+            return *this;
+        }
+
+        Tracked& operator=(Tracked const& other)
+        {
+            value = other.value;
+            TRACKER_IF(COPIES)
+                assign(ModificationType::AsgCopy, &other);
+
+            return *this;
+        }
+
+        Tracked& operator=(Tracked&& other) noexcept(std::is_nothrow_move_assignable_v<T>)
+        {
+            value = std::move(other.value);
+            TRACKER_IF(COPIES)
+                assign(ModificationType::AsgMove, &other);
+
+            return *this;
+        }
+
+        ~Tracked()
+        {
+            TRACKER_IF(LIFETIMES)
+            {
+                if (info.id >= 0)
+                {
+                    info.bytes = footprint(value);
+                    TRACKER_DISPATCHER.enterDTOR(info);
+                }
+            }
+        }
+
+        T& get() { return value; }
+        T const& get() const { return value; }
+        T& operator*() { return value; }
+        T const& operator*() const { return value; }
+        T* operator->() { return &value; }
+        T const* operator->() const { return &value; }
+        operator T const&() const { return value; }
+
+        TrackedInfo const& trackedInfo() const { return info; }
+
+    protected:
+        T value;
+        mutable TrackedInfo info; // sources made while tracking was off are named when used
+
+        //
+        // Bytes are measured on the destination: after a copy or a
+        // move it holds what the event carried. Objects are named at
+        // every level, constructions are reported from LIFETIMES on.
+        // Objects made while tracking was off are named on first use.
+        //
+
+        void enter(ModificationType type, char const* name, Site const& site, Tracked const* other = nullptr)
+        {
+            if (other)
+                other->adopt();
+
+            TRACKER_DISPATCHER.setName(info, name, trackedTypeId<Tracked, T>());
+            info.site = TRACKER_DISPATCHER.callSite(site);
+            info.value = capture(value);
+            info.address = this;
+            info.bytes = footprint(value);
+            TRACKER_DISPATCHER.setHistory(type, info, other ? &other->info : nullptr);
+
+            switch (type)
+            {
+            case ModificationType::CTOR:
+                TRACKER_AT(LIFETIMES)
+                    TRACKER_DISPATCHER.enterCTOR(info);
+                break;
+
+            case ModificationType::CTORCopy:
+                TRACKER_DISPATCHER.enterCTORCopy(info, other->info);
+                break;
+
+            default:
+                TRACKER_DISPATCHER.enterCTORMove(info, other->info);
+                break;
+            }
+        }
+
+        void adopt() const
+        {
+            if (!TRACKER_DISPATCHER.adopt(info, this, trackedTypeId<Tracked, T>()))
+                return;
+
+            info.value = capture(value);
+            info.bytes = footprint(value);
+        }
+
+        void assign(ModificationType type, Tracked const* other = nullptr)
+        {
+            if (other)
+                other->adopt();
+
+            adopt();
+            info.site = TRACKER_DISPATCHER.callSite();
+            info.value = capture(value);
+            info.bytes = footprint(value);
+            TRACKER_DISPATCHER.setHistory(type, info, other ? &other->info : nullptr);
+
+            switch (type)
+            {
+            case ModificationType::Asg:
+                TRACKER_DISPATCHER.enterAsg(info);
+                break;
+
+            case ModificationType::AsgCopy:
+                TRACKER_DISPATCHER.enterAsgCopy(info, other->info);
+                break;
+
+            default:
+                TRACKER_DISPATCHER.enterAsgMove(info, other->info);
+                break;
+            }
+        }
+    };
+
+    //
+    // The trailing Site must not make the moves throw, or vectors of
+    // Tracked copy on every reallocation
+    //
+
+    static_assert(std::is_nothrow_move_constructible_v<Tracked<int>>);
+    static_assert(std::is_nothrow_move_constructible_v<Tracked<std::string>>);
+}
+
+#endif // !TRACKER_TRACKED
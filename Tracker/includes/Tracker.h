@@ -26,15 +26,77 @@ Revision History:
 //
 
 #include <string>
-#include <stack>
 #include <vector>
 #include <map>
 #include <set>
+#include <tuple>
+#include <array>
+#include <initializer_list>
+#include <type_traits>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
 
 //
 // Defines
 //
 
+//
+// Dispatcher used by TRACKER_* macros and tracked classes. To use a
+// compile-time sink set, define it before including this header and
+// declare the object before including tracked classes, e.g.
+//
+//     #define TRACKER_DISPATCHER consoleTracker
+//     #include <Tracker.h>
+//     Tracker::BasicMainLogger<Tracker::ConsoleLogger> consoleTracker;
+//
+
+#ifndef TRACKER_DISPATCHER
+#define TRACKER_DISPATCHER Tracker::mainLogger
+#endif
+
+//
+// Event classes compiled in. Each level adds a class to the previous
+// ones, events above TRACKER_LEVEL leave no code in tracked classes.
+//
+//     1  copies and moves
+//     2  + constructions and destructions
+//     3  + plain and compound assignments
+//     4  + function scopes (default)
+//
+
+#define TRACKER_LEVEL_COPIES      1
+#define TRACKER_LEVEL_LIFETIMES   2
+#define TRACKER_LEVEL_ASSIGNMENTS 3
+#define TRACKER_LEVEL_SCOPES      4
+
+#ifndef TRACKER_LEVEL
+#define TRACKER_LEVEL TRACKER_LEVEL_SCOPES
+#endif
+
+//
+// Guards the instrumentation of one event class in tracked classes:
+// compiled out above TRACKER_LEVEL, skipped while tracking is off.
+// TRACKER_AT only compiles out, for the send of an event whose
+// object is still named at lower levels: a copy needs the id of its
+// source even when constructions are not reported.
+//
+
+#define TRACKER_AT(level) \
+    if constexpr (TRACKER_LEVEL >= TRACKER_LEVEL_##level)
+
+#define TRACKER_IF(level) \
+    TRACKER_AT(level) \
+        if (TRACKER_DISPATCHER.enabled())
+
+#define TRACKER_FOR_EACH_SINK(call) \
+    std::apply([&](auto&... sink) { (sink.std::decay_t<decltype(sink)>::call, ...); }, sinks)
+
 namespace Tracker
 {
     enum class ModificationType
@@ -49,21 +111,625 @@ namespace Tracker
         AsgOper,
     };
 
+    int const nModificationTypes = static_cast<int>(ModificationType::AsgOper) + 1;
+
+    //
+    // Value of a tracked object: its raw bits and the function that
+    // formats them. Nothing is formatted until a sink prints it.
+    // Types that are not arithmetic or pointers, and every type when
+    // TRACKER_NO_VALUES is defined, are captured without a formatter.
+    //
+
+    struct TrackedValue
+    {
+        using Formatter = int (*)(char* buffer, std::size_t size, std::uint64_t bits);
+
+        std::uint64_t bits = 0;
+        Formatter format = nullptr;
+
+        std::string str() const;
+    };
+
+    template <typename T>
+    int formatValue(char* buffer, std::size_t size, std::uint64_t bits)
+    {
+        T value;
+        memcpy(&value, &bits, sizeof(T));
+
+        if constexpr (std::is_floating_point_v<T>)
+            return snprintf(buffer, size, "%g", double(value));
+        else if constexpr (std::is_pointer_v<T>)
+            return snprintf(buffer, size, "%p", (void const*)value);
+        else if constexpr (std::is_signed_v<T>)
+            return snprintf(buffer, size, "%lld", (long long)value);
+        else
+            return snprintf(buffer, size, "%llu", (unsigned long long)value);
+    }
+
+    //
+    // Values of the same kind and size share a formatter, so that
+    // the set of formatters is small and known (see Trace.cpp)
+    //
+
+    template <typename T>
+    TrackedValue::Formatter formatterOf()
+    {
+        using Signed = std::conditional_t<sizeof(T) == 1, std::int8_t,
+                       std::conditional_t<sizeof(T) == 2, std::int16_t,
+                       std::conditional_t<sizeof(T) == 4, std::int32_t, std::int64_t>>>;
+
+        if constexpr (std::is_pointer_v<T>)
+            return &formatValue<void const*>;
+        else if constexpr (std::is_floating_point_v<T>)
+            return &formatValue<T>;
+        else if constexpr (std::is_signed_v<T>)
+            return &formatValue<Signed>;
+        else
+            return &formatValue<std::make_unsigned_t<Signed>>;
+    }
+
+    template <typename T>
+    TrackedValue capture([[maybe_unused]] T const& value)
+    {
+        TrackedValue captured;
+#ifndef TRACKER_NO_VALUES
+        if constexpr ((std::is_arithmetic_v<T> || std::is_pointer_v<T>) && sizeof(T) <= sizeof(captured.bits))
+        {
+            memcpy(&captured.bits, &value, sizeof(T));
+            captured.format = formatterOf<T>();
+        }
+#endif
+        return captured;
+    }
+
+    //
+    // Per-object state kept inside every tracked object. Strings live
+    // in side tables: name is an id in names(), or the temporary's
+    // number if Flags::Temp is set, function is an id in functions(),
+    // type is an id in types(), site is the call site of the latest
+    // event in sites() and history is a node of the dispatcher's
+    // Provenance.
+    //
+
     struct TrackedInfo
     {
-        int id;
+        enum Flags : std::uint32_t
+        {
+            Temp    = 1 << 0,
+            Sampled = 1 << 1,
+        };
+
+        int id = -1;
+        int name = -1;
+        int function = -1;
+        int history = -1;
+        std::uint32_t flags = 0;
+        int type = -1;
+        int site = -1;
+        std::uint32_t bytes = 0; // involved in the latest event
+        void* address = nullptr;
+        TrackedValue value;
+
+        bool isTemp() const { return flags & Temp; }
+        bool isSampled() const { return flags & Sampled; }
+    };
+
+    //
+    // Interned strings. Function names are interned once per
+    // call site, object names once per distinct name.
+    //
+
+    struct StringTable
+    {
+        int intern(std::string const& name);
+        std::string const& name(int id) const;
+
+    private:
+        mutable std::mutex mutex;
+        std::deque<std::string> names;
+        std::map<std::string, int> ids;
+    };
+
+    StringTable& functions();
+    StringTable& names();
+    StringTable& types();
+    StringTable& sites();
+    int internFunction(char const* name);
+    int internType(char const* signature);
+    int internSite(char const* file, int line);
+    std::string const& functionName(int id);
+    std::string const& typeName(int id);
+    std::string const& siteName(int id);
+    std::string objectName(int name, std::uint32_t flags);
+    std::string objectName(TrackedInfo const& info);
+
+    //
+    // Call site of a tracked construction, taken from default arguments
+    // at the caller. The tag keeps a stray string argument from being
+    // converted to a Site. Sites in system headers have no id: a copy
+    // made by std::vector is attributed to its CallSite instead. Making
+    // a Site never throws, id() interns it and may.
+    //
+
+    struct Site
+    {
+        struct Here {};
+
+        char const* file;
+        int line;
+
+        Site(Here = {}, char const* file = __builtin_FILE(), int line = __builtin_LINE()) noexcept :
+            file(file),
+            line(line)
+        {
+        }
+
+        int id() const { return internSite(file, line); }
+    };
+
+    //
+    // Site of the container call that TRACKER_CALL wraps, -1 outside
+    // of one. Nested calls restore the outer site on the way out.
+    //
+
+    struct CallSite
+    {
+        inline static thread_local int current = -1;
+
+        explicit CallSite(Site const& site) :
+            previous(current)
+        {
+            current = site.id();
+        }
+
+        ~CallSite()
+        {
+            current = previous;
+        }
+
+        CallSite(CallSite const&) = delete;
+        CallSite& operator=(CallSite const&) = delete;
+
+    private:
+        int previous;
+    };
+
+    //
+    // Id of T in types(), the name is taken from the signature
+    //
+
+    template <typename T>
+    int typeId()
+    {
+        static int const id = internType(__PRETTY_FUNCTION__);
+        return id;
+    }
+
+    //
+    // Move traits of tracked types, registered when a type is first
+    // tracked. A type whose moves may throw is reported right away:
+    // std containers copy it instead of moving when they relocate.
+    //
+
+    struct TypeTraits
+    {
+        bool isRegistered = false;
+        bool isNothrowMoveConstructible = true;
+        bool isNothrowMoveAssignable = true;
+    };
+
+    int registerType(int type, TypeTraits const& traits);
+    TypeTraits typeTraits(int type);
+    std::vector<int> throwingMoveTypes();
+
+    //
+    // Id of a tracked type T, reported under the name of Named
+    // (wrappers report the type they wrap)
+    //
+
+    template <typename T, typename Named = T>
+    int trackedTypeId()
+    {
+        static int const id = registerType(typeId<Named>(), { true,
+                                                              std::is_nothrow_move_constructible_v<T>,
+                                                              std::is_nothrow_move_assignable_v<T> });
+        return id;
+    }
+
+    //
+    // Nanoseconds from an arbitrary origin. Read from the time stamp
+    // counter where it runs at a constant rate, at a scale calibrated
+    // against steady_clock when the first timestamp is taken; from
+    // steady_clock elsewhere.
+    //
+
+    struct Clock
+    {
+        std::uint64_t origin = 0; // ticks
+        std::uint64_t scale = 0;  // ns per tick in 32.32 fixed point, 0 without a usable counter
+
+        static Clock calibrate();
+        static std::uint64_t steady();
+    };
+
+    inline std::uint64_t timestamp()
+    {
+        static Clock const clock = Clock::calibrate();
+#if defined(__x86_64__)
+        if (clock.scale)
+            return std::uint64_t((unsigned __int128)(__builtin_ia32_rdtsc() - clock.origin) * clock.scale >> 32);
+#endif
+        return Clock::steady();
+    }
+
+    //
+    // Stack of entered functions. The dispatcher owns one per thread,
+    // loggers that replay events own their own. current points to the
+    // stack of the stream being delivered on this thread, it is what
+    // sinks read. time is the timestamp of the event being delivered,
+    // 0 for "now": events are stamped when a sink asks, with
+    // Logger::eventTime(), scopes always are. enterFunction is
+    // delivered before the push and exitFunction after the pop. Open
+    // reallocation windows nest like scopes and count towards depth()
+    // in the same way.
+    //
+
+    struct ScopeStack
+    {
+        inline static thread_local ScopeStack* current = nullptr;
+        std::uint64_t time = 0;
+
+        void push(int function) { functions.push_back(function); }
+        void pop() { functions.pop_back(); }
+        void open() { windows++; }
+        void close() { windows--; }
+        int depth() const { return functions.size() + windows; }
+        int scopes() const { return functions.size(); }
+        int top() const { return functions.empty() ? -1 : functions.back(); }
+        int at(int index) const { return functions[index]; }
+
+    private:
+        std::vector<int> functions;
+        int windows = 0;
+    };
+
+    //
+    // Per-thread instances of State owned by one object. State must
+    // have an int lane member, it receives the registration index.
+    //
+
+    inline std::size_t nextSerial()
+    {
+        static std::atomic<std::size_t> serial = 0;
+        return ++serial;
+    }
+
+    template <typename State>
+    struct PerThread
+    {
+        State& local()
+        {
+            struct Entry
+            {
+                std::size_t serial;
+                State* state;
+            };
+
+            thread_local Entry last = { 0, nullptr };
+            thread_local std::vector<Entry> cache;
+
+            if (last.serial == serial)
+                return *last.state;
+
+            for (auto const& entry : cache)
+            {
+                if (entry.serial == serial)
+                {
+                    last = entry;
+                    return *entry.state;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            states.push_back(std::make_unique<State>());
+            states.back()->lane = states.size() - 1;
+            last = { serial, states.back().get() };
+            cache.push_back(last);
+            return *last.state;
+        }
+
+        template <typename Function>
+        void forEach(Function function)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto const& state : states)
+                function(*state);
+        }
+
+        template <typename Function>
+        void forEach(Function function) const
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto const& state : states)
+                function(static_cast<State const&>(*state));
+        }
+
+    private:
+        std::size_t const serial = nextSerial();
+        mutable std::mutex mutex;
+        std::vector<std::unique_ptr<State>> states;
+    };
+
+    //
+    // Append-only graph of modifications. A node refers to the previous
+    // node of the same object (self) and to the node of the object its
+    // value came from (source). History strings are rendered on demand.
+    // With a capacity set only the latest nodes are kept, chains end
+    // where the forgotten nodes were. Every thread appends to a history
+    // of its own, ids come from one counter; queries look a node up in
+    // all the histories, so appends on different threads do not contend.
+    //
+
+    struct Provenance
+    {
+        struct Node
+        {
+            ModificationType type;
+            char oper[4];
+            int object;
+            int self;
+            int source;
+            int name;             // of the source object
+            std::uint32_t flags;  // of the source object
+            TrackedValue value;   // for CTOR and Asg
+        };
+
+        int append(Node const& node);
+        Node node(int id) const;
+        int size() const;
+        void setCapacity(std::size_t capacity); // 0 keeps every node
+
+        std::string render(int id, std::size_t limit = 4096) const;
+        int origin(int id) const;
+        int hops(int id) const;
+        std::vector<int> roots(int id) const;
+
+    private:
+        struct Entry
+        {
+            int id;
+            Node node;
+        };
+
+        struct alignas(64) History
+        {
+            int lane;
+            mutable std::mutex mutex; // uncontended but for queries
+            std::deque<Entry> entries; // ascending ids
+        };
+
+        PerThread<History> histories;
+        std::atomic<int> next = 0;
+        std::atomic<std::size_t> capacity = 0;
+
+        int previous(Node const& node) const;
+        bool find(int id, Node& node) const;
+        void trim(History& history, int end);
+    };
+
+    //
+    // Allocator event. An allocation that replaces a live block of
+    // another size is a reallocation: it opens a window that the
+    // release of the previous block closes, element events in between
+    // are the relocation. copies and moves are set when it closes.
+    //
+
+    struct AllocInfo
+    {
+        enum class Kind : std::uint8_t
+        {
+            Alloc,
+            Realloc,
+            Free,
+        };
+
+        enum Flags : std::uint8_t
+        {
+            ThrowingMove = 1 << 0, // relocation falls back to copies
+        };
+
+        Kind kind;
+        std::uint8_t flags;
+        int type;
+        int site;
+        std::uint32_t size;          // of an element
+        std::uint32_t count;         // elements in the block
+        std::uint32_t previousCount; // elements in the previous block
+        std::uint32_t copies;
+        std::uint32_t moves;
         void* address;
-        std::string name;
-        std::string value;
-        std::string history;
-        std::string function;
-        bool isTemp = false;
+        void* previous;
+    };
+
+    //
+    // Detailed events are delivered only for sampled objects. An object
+    // is sampled at birth if the hash of its id falls into 1 of every
+    // N and its type and function pass the filters, empty filters pass
+    // everything. Copies, moves and assignments from a sampled object
+    // sample the destination. Totals still count every object. Sinks
+    // draw a sampled copy of an unsampled source with a source of its
+    // own.
+    //
+
+    struct Sampling
+    {
+        int every = 1; // 0 and 1 keep every object
+        std::uint64_t seed = 0;
+        std::set<int> types;     // ids in types()
+        std::set<int> functions; // ids in functions()
+
+        Sampling& onlyType(std::string const& name);
+        Sampling& onlyFunction(std::string const& name);
+        bool isActive() const;
+    };
+
+    //
+    // Event counts by modification type, overall, per tracked type, per
+    // function the event happened in and per call site, plus the number
+    // of temporaries created at each site. Bytes reported by events are
+    // summed overall, per type and per site, allocator activity overall.
+    // Scopes add their calls and wall time per function: inclusive, and
+    // exclusive of the scopes they called, in ns. Rows are flat arrays
+    // indexed by the interned id shifted by one, so that -1 (no type,
+    // no scope, no site) has a row too.
+    //
+
+    struct Counters
+    {
+        using Row = std::array<std::uint64_t, nModificationTypes>;
+        using Kinds = std::initializer_list<ModificationType>;
+
+        struct Entry
+        {
+            int id;
+            std::uint64_t count;
+        };
+
+        struct Allocations
+        {
+            std::uint64_t allocs = 0;
+            std::uint64_t reallocs = 0;
+            std::uint64_t frees = 0;
+            std::uint64_t bytes = 0;  // allocated
+            std::uint64_t copies = 0; // during reallocations
+            std::uint64_t moves = 0;  // during reallocations
+        };
+
+        void add(ModificationType kind, TrackedInfo const& info, int function)
+        {
+            auto index = static_cast<int>(kind);
+            totals[index]++;
+            row(types, info.type)[index]++;
+            row(functions, function)[index]++;
+            row(sites, info.site)[index]++;
+
+            bool isBirth = kind == ModificationType::CTOR ||
+                           kind == ModificationType::CTORCopy ||
+                           kind == ModificationType::CTORMove;
+            if (info.isTemp() && isBirth)
+                row(temporaries, info.site)++;
+
+            if (info.bytes)
+            {
+                byteTotals[index] += info.bytes;
+                row(typeBytes, info.type)[index] += info.bytes;
+                row(siteBytes, info.site)[index] += info.bytes;
+            }
+        }
+
+        void addScope(int function, std::uint64_t inclusive, std::uint64_t exclusive)
+        {
+            row(calls, function)++;
+            row(inclusiveTimes, function) += inclusive;
+            row(exclusiveTimes, function) += exclusive;
+        }
+
+        void addAlloc(AllocInfo const& info);
+        void addRealloc(AllocInfo const& info);
+        void merge(Counters const& other);
+        Row const& snapshot() const { return totals; }
+
+        std::uint64_t total(Kinds kinds) const;
+        std::uint64_t byType(int type, Kinds kinds) const;
+        std::uint64_t byFunction(int function, Kinds kinds) const;
+        std::uint64_t bySite(int site, Kinds kinds) const;
+        std::uint64_t temporariesAt(int site) const;
+        std::uint64_t relocationCopiesAt(int site) const;
+        std::uint64_t callsOf(int function) const;
+        std::uint64_t inclusiveTime(int function) const;
+        std::uint64_t exclusiveTime(int function) const;
+        std::uint64_t bytes(Kinds kinds) const;
+        std::uint64_t bytesByType(int type, Kinds kinds) const;
+        std::uint64_t bytesBySite(int site, Kinds kinds) const;
+        std::vector<Entry> topTypes(Kinds kinds, std::size_t n) const;
+        std::vector<Entry> topFunctions(Kinds kinds, std::size_t n) const;
+        std::vector<Entry> topSites(Kinds kinds, std::size_t n) const;
+        std::vector<Entry> topTemporarySites(std::size_t n) const;
+        std::vector<Entry> topRelocationSites(std::size_t n) const;
+        std::vector<Entry> topTypesByBytes(Kinds kinds, std::size_t n) const;
+        std::vector<Entry> topFunctionsByTime(std::size_t n, bool isExclusive = true) const;
+        Allocations const& allocations() const { return allocs; }
+
+    private:
+        Row totals = {};
+        std::vector<Row> types;
+        std::vector<Row> functions;
+        std::vector<Row> sites;
+        std::vector<std::uint64_t> temporaries;
+        std::vector<std::uint64_t> relocationCopies;
+        std::vector<std::uint64_t> calls;
+        std::vector<std::uint64_t> inclusiveTimes;
+        std::vector<std::uint64_t> exclusiveTimes;
+        Row byteTotals = {};
+        std::vector<Row> typeBytes;
+        std::vector<Row> siteBytes;
+        Allocations allocs;
+
+        template <typename T>
+        static T& row(std::vector<T>& rows, int id)
+        {
+            if (std::size_t(id + 1) >= rows.size())
+                rows.resize(id + 2, T{});
+
+            return rows[id + 1];
+        }
+    };
+
+    //
+    // Open scopes of one stream with the time they were entered at and
+    // the time spent in the scopes they called. exit() adds the scope
+    // to counters.
+    //
+
+    struct ScopeTimer
+    {
+        void enter(std::uint64_t time)
+        {
+            spans.push_back({ time, 0 });
+        }
+
+        void exit(Counters& counters, int function, std::uint64_t time)
+        {
+            if (spans.empty())
+                return;
+
+            auto span = spans.back();
+            spans.pop_back();
+
+            auto inclusive = time - span.entered;
+            counters.addScope(function, inclusive, inclusive - span.nested);
+            if (!spans.empty())
+                spans.back().nested += inclusive;
+        }
+
+        std::uint64_t entered(int index) const { return spans[index].entered; }
+
+    private:
+        struct Span
+        {
+            std::uint64_t entered;
+            std::uint64_t nested;
+        };
+
+        std::vector<Span> spans;
     };
 
+    struct MainLoggerBase;
+
     struct Logger
     {
-        virtual void enterFunction(std::string name) = 0;
-        virtual void exitFunction();
+        virtual void enterFunction(int function) = 0;
+        virtual void exitFunction() = 0;
         virtual void enterDTOR(TrackedInfo const& info) = 0;
         virtual void enterCTOR(TrackedInfo const& info) = 0;
         virtual void enterCTORCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom) = 0;
@@ -72,23 +738,302 @@ namespace Tracker
         virtual void enterAsgCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom) = 0;
         virtual void enterAsgMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom) = 0;
         virtual void enterAsgOper(TrackedInfo const& infoTo, TrackedInfo const& infoFrom, std::string const& oper) = 0;
+        virtual void enterAlloc(AllocInfo const& info);
+        virtual void exitAlloc(AllocInfo const& info);
+        virtual void enterLane(int lane);
+        virtual void attach(MainLoggerBase const* owner);
         virtual ~Logger() = default;
 
     protected:
-        std::stack<std::string> calls;
+        MainLoggerBase const* owner = nullptr;
+        int lane = 0;
+        bool hasLanes = false;
         int depth();
-        void pushFunction(std::string const& name);
+        std::uint64_t eventTime();
     };
 
-    struct MainLogger : public Logger
+    //
+    // Bookkeeping shared by every dispatcher: ids, names,
+    // histories and totals. Dispatchers only add the fan-out.
+    // Ids are atomic, scope stacks and counters are per thread,
+    // query counters while the tracked threads are quiescent. Scopes
+    // entered while tracking is off are neither stacked nor timed.
+    // Sampling is set before tracking starts; while it is active
+    // a scope reaches the sinks only once a delivered event
+    // happens inside it.
+    //
+
+    struct MainLoggerBase
     {
-        void addNewLogger(Logger* logger);
+        struct Totals
+        {
+            int obj = 0;
+            int copy = 0;
+            int move = 0;
+        };
+
         void setHistory(ModificationType type, TrackedInfo& info, TrackedInfo const* other = nullptr, std::string const& oper = "");
-        void setName(TrackedInfo& info, std::string const& name);
+        void setName(TrackedInfo& info, char const* name, int type = -1);
+        void setName(TrackedInfo& info, std::string const& name, int type = -1) { setName(info, name.c_str(), type); }
+        bool adopt(TrackedInfo& info, void const* address, int type); // names objects made while tracking was off
+        void setSampling(Sampling const& sampling);
+        void setHistoryLimit(std::size_t nodes) { provenance.setCapacity(nodes); }
         void on();
         void off();
+        bool enabled() const { return isOn.load(std::memory_order_relaxed); }
+        Totals getTotal() const;
+        Counters getCounters() const;
+        int scopeSite();
+        int callSite();
+        int callSite(Site const& site);
+        std::string history(TrackedInfo const& info) const;
+        Provenance const& getProvenance() const { return provenance; }
+
+    protected:
+        struct alignas(64) ThreadState
+        {
+            int lane;
+            Counters counters;
+            ScopeStack calls; // entered
+            ScopeStack shown; // delivered to sinks
+            std::vector<int> sites; // of the entered scopes
+            ScopeTimer timer;       // of the entered scopes
+            std::vector<Counters::Row> windows; // counts when they opened
+        };
+
+        std::atomic<int> currentId = 0;
+        std::atomic<int> tmpCounter = 0;
+        std::atomic<bool> isOn = true;
+        PerThread<ThreadState> threads;
+        Provenance provenance;
+        Sampling sampling;
+        bool isSampling = false;
+
+        int getId();
+        bool sample(TrackedInfo const& info) const;
+
+        void count(ThreadState& state, ModificationType kind, TrackedInfo const& info)
+        {
+            state.counters.add(kind, info, state.calls.top());
+        }
+
+        ThreadState& local()
+        {
+            auto& state = threads.local();
+            ScopeStack::current = &state.shown;
+            return state;
+        }
+    };
+
+    //
+    // Dispatcher with a sink set fixed at compile time. Sinks are held
+    // by value and called with qualified names, so the calls are not
+    // virtual and hooks with empty bodies inline to nothing.
+    //
+
+    template <typename... Sinks>
+    struct BasicMainLogger : public MainLoggerBase
+    {
+        BasicMainLogger()
+        {
+            TRACKER_FOR_EACH_SINK(attach(this));
+        }
+
+        template <typename Sink>
+        Sink& sink()
+        {
+            return std::get<Sink>(sinks);
+        }
+
+        void enterFunction(int function, int site = -1)
+        {
+            auto& state = local();
+            state.calls.push(function);
+            state.sites.push_back(site);
+            state.timer.enter(timestamp());
+            if (!isSampling)
+                reveal(state);
+        }
+
+        void exitFunction()
+        {
+            auto& state = local();
+            auto time = timestamp();
+            state.timer.exit(state.counters, state.calls.top(), time);
+            if (state.shown.scopes() == state.calls.scopes())
+            {
+                state.shown.pop();
+                state.shown.time = time;
+                TRACKER_FOR_EACH_SINK(exitFunction());
+            }
+
+            state.calls.pop();
+            state.sites.pop_back();
+        }
+
+        void enterDTOR(TrackedInfo const& info)
+        {
+            if (!isOn) return;
+            auto& state = local();
+            count(state, ModificationType::DTOR, info);
+            if (!show(state, info)) return;
+            TRACKER_FOR_EACH_SINK(enterDTOR(info));
+        }
+
+        void enterCTOR(TrackedInfo const& info)
+        {
+            if (!isOn) return;
+            auto& state = local();
+            count(state, ModificationType::CTOR, info);
+            if (!show(state, info)) return;
+            TRACKER_FOR_EACH_SINK(enterCTOR(info));
+        }
 
-        virtual void enterFunction(std::string name);
+        void enterCTORCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+        {
+            if (!isOn) return;
+            auto& state = local();
+            count(state, ModificationType::CTORCopy, infoTo);
+            if (!show(state, infoTo)) return;
+            TRACKER_FOR_EACH_SINK(enterCTORCopy(infoTo, infoFrom));
+        }
+
+        void enterCTORMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+        {
+            if (!isOn) return;
+            auto& state = local();
+            count(state, ModificationType::CTORMove, infoTo);
+            if (!show(state, infoTo)) return;
+            TRACKER_FOR_EACH_SINK(enterCTORMove(infoTo, infoFrom));
+        }
+
+        void enterAsg(TrackedInfo const& info)
+        {
+            if (!isOn) return;
+            auto& state = local();
+            count(state, ModificationType::Asg, info);
+            if (!show(state, info)) return;
+            TRACKER_FOR_EACH_SINK(enterAsg(info));
+        }
+
+        void enterAsgCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+        {
+            if (!isOn) return;
+            auto& state = local();
+            count(state, ModificationType::AsgCopy, infoTo);
+            if (!show(state, infoTo)) return;
+            TRACKER_FOR_EACH_SINK(enterAsgCopy(infoTo, infoFrom));
+        }
+
+        void enterAsgMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom)
+        {
+            if (!isOn) return;
+            auto& state = local();
+            count(state, ModificationType::AsgMove, infoTo);
+            if (!show(state, infoTo)) return;
+            TRACKER_FOR_EACH_SINK(enterAsgMove(infoTo, infoFrom));
+        }
+
+        void enterAsgOper(TrackedInfo const& infoTo, TrackedInfo const& infoFrom, std::string const& oper)
+        {
+            if (!isOn) return;
+            auto& state = local();
+            count(state, ModificationType::AsgOper, infoTo);
+            if (!show(state, infoTo)) return;
+            TRACKER_FOR_EACH_SINK(enterAsgOper(infoTo, infoFrom, oper));
+        }
+
+        //
+        // Allocator events bypass sampling, they are rare and give
+        // the sampled element events their context
+        //
+
+        void enterAlloc(AllocInfo const& info)
+        {
+            auto& state = local();
+            state.counters.addAlloc(info);
+            reveal(state);
+            state.shown.time = 0;
+            TRACKER_FOR_EACH_SINK(enterAlloc(info));
+
+            if (info.kind == AllocInfo::Kind::Realloc)
+            {
+                state.windows.push_back(state.counters.snapshot());
+                state.shown.open();
+            }
+        }
+
+        void exitAlloc(AllocInfo& info)
+        {
+            auto& state = local();
+            auto opened = state.windows.back();
+            state.windows.pop_back();
+
+            auto now = state.counters.snapshot();
+            auto delta = [&](std::initializer_list<ModificationType> kinds)
+            {
+                std::uint64_t result = 0;
+                for (auto kind : kinds)
+                    result += now[static_cast<int>(kind)] - opened[static_cast<int>(kind)];
+
+                return std::uint32_t(result);
+            };
+
+            info.copies = delta({ ModificationType::CTORCopy, ModificationType::AsgCopy });
+            info.moves = delta({ ModificationType::CTORMove, ModificationType::AsgMove });
+            state.counters.addRealloc(info);
+
+            state.shown.close();
+            state.shown.time = 0;
+            TRACKER_FOR_EACH_SINK(exitAlloc(info));
+        }
+
+    protected:
+        std::tuple<Sinks...> sinks;
+
+        //
+        // Delivers the entered scopes the sinks have not seen yet,
+        // at the time they were entered
+        //
+
+        void reveal(ThreadState& state)
+        {
+            while (state.shown.scopes() < state.calls.scopes())
+            {
+                int index = state.shown.scopes();
+                int function = state.calls.at(index);
+                state.shown.time = state.timer.entered(index);
+                TRACKER_FOR_EACH_SINK(enterFunction(function));
+                state.shown.push(function);
+            }
+        }
+
+        //
+        // The destination of an event decides, sampling has
+        // already spread to it from a sampled source
+        //
+
+        bool show(ThreadState& state, TrackedInfo const& info)
+        {
+            if (isSampling && !info.isSampled())
+                return false;
+
+            reveal(state);
+            state.shown.time = 0;
+            return true;
+        }
+    };
+
+    //
+    // Sink that forwards to loggers registered at run time.
+    // Owns the loggers it was given.
+    //
+
+    struct DynamicLogger : public Logger
+    {
+        void addNewLogger(Logger* logger);
+
+        virtual void enterFunction(int function);
         virtual void exitFunction() override;
         virtual void enterDTOR(TrackedInfo const& info);
         virtual void enterCTOR(TrackedInfo const& info);
@@ -98,25 +1043,41 @@ namespace Tracker
         virtual void enterAsgCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
         virtual void enterAsgMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
         virtual void enterAsgOper(TrackedInfo const& infoTo, TrackedInfo const& infoFrom, std::string const& oper);
-        virtual ~MainLogger();
+        virtual void enterAlloc(AllocInfo const& info) override;
+        virtual void exitAlloc(AllocInfo const& info) override;
+        virtual void enterLane(int lane) override;
+        virtual void attach(MainLoggerBase const* owner) override;
+        virtual ~DynamicLogger();
 
     protected:
-        int currentId = 0;
-        int tmpCounter = 0;
-        bool isOn = true;
+        std::vector<Logger*> loggers;
+    };
 
-        struct
-        {
-            int obj = 0;
-            int copy = 0;
-            int move = 0;
-        } total;
+    struct MainLogger : public BasicMainLogger<DynamicLogger>
+    {
+        void addNewLogger(Logger* logger);
+    };
 
-        std::vector<Logger*> loggers;
-        int getId();
-    
-    public:
-        decltype(total) getTotal() { return total; }
+    //
+    // Base for compile-time sinks: every hook is empty and inline,
+    // so a sink defines only the hooks it needs.
+    //
+
+    struct NullLogger
+    {
+        void enterFunction(int) {}
+        void exitFunction() {}
+        void enterDTOR(TrackedInfo const&) {}
+        void enterCTOR(TrackedInfo const&) {}
+        void enterCTORCopy(TrackedInfo const&, TrackedInfo const&) {}
+        void enterCTORMove(TrackedInfo const&, TrackedInfo const&) {}
+        void enterAsg(TrackedInfo const&) {}
+        void enterAsgCopy(TrackedInfo const&, TrackedInfo const&) {}
+        void enterAsgMove(TrackedInfo const&, TrackedInfo const&) {}
+        void enterAsgOper(TrackedInfo const&, TrackedInfo const&, std::string const&) {}
+        void enterAlloc(AllocInfo const&) {}
+        void exitAlloc(AllocInfo const&) {}
+        void attach(MainLoggerBase const*) {}
     };
 
     struct TextLogger : public Logger
@@ -134,7 +1095,7 @@ namespace Tracker
             WhiteB,
         };
 
-        virtual void enterFunction(std::string name);
+        virtual void enterFunction(int function);
         virtual void exitFunction() override;
         virtual void enterDTOR(TrackedInfo const& info);
         virtual void enterCTOR(TrackedInfo const& info);
@@ -144,43 +1105,142 @@ namespace Tracker
         virtual void enterAsgCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
         virtual void enterAsgMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
         virtual void enterAsgOper(TrackedInfo const& infoTo, TrackedInfo const& infoFrom, std::string const& oper);
+        virtual void enterAlloc(AllocInfo const& info) override;
+        virtual void exitAlloc(AllocInfo const& info) override;
 
     protected:
         virtual void printInfo(TrackedInfo const& info);
+        virtual void printBlock(AllocInfo const& info, std::uint32_t count, void* address);
+        virtual void printLane();
+        virtual void printSummary();
         virtual void printAllign() = 0;
         virtual void printColor(Color color, std::string const& str) = 0;
     };
 
+    //
+    // A line is assembled and written to stdout at once. Colors are
+    // dropped when stdout is not a terminal, unless asked for. With
+    // isBuffered lines are gathered up to bufferSize before they are
+    // written, for logs redirected to a file: the program's own
+    // output then no longer lands between the lines it belongs to.
+    //
+
     struct ConsoleLogger : public TextLogger
     {
+        enum class Colors
+        {
+            Auto,
+            Always,
+            Never,
+        };
+
+        struct Options
+        {
+            Colors colors = Colors::Auto;
+            bool isBuffered = false;
+        };
+
         static int const width = 8;
+        static std::size_t const bufferSize = 1 << 16;
+        ConsoleLogger();
+        explicit ConsoleLogger(Options const& options);
         virtual ~ConsoleLogger();
 
     protected:
         virtual void printAllign();
         virtual void printColor(TextLogger::Color color, std::string const& str);
+        Options options;
+        bool isColored;
+        std::string line;
+
+        void flush();
     };
 
+    //
+    // The log is split into pages of about pageBytes, written to
+    // trackerlog/ as scripts. The index, trackerlog.html, lists them
+    // and loads a page when it is opened, so that the browser never
+    // holds more than the pages being read. Function scopes fold;
+    // the ones open at a page break are reopened on the next page.
+    //
+
     struct HtmlLogger : public TextLogger
     {
         static int const width = 8;
         static int const fontSize = 14;
+        static std::size_t const pageBytes = 1 << 20;
         HtmlLogger();
         virtual ~HtmlLogger();
 
+        virtual void enterFunction(int function);
+        virtual void exitFunction() override;
+
     protected:
         virtual void printAllign();
         virtual void printColor(TextLogger::Color color, std::string const& str);
+        virtual void writePage(int number, std::string const& content);
         char const* filename = "trackerlog.html";
-        FILE* file;
+        char const* directory = "trackerlog";
+        FILE* file; // the index
+
+        struct Scope
+        {
+            std::string name;
+            std::string indent;
+        };
+
+        std::string page;
+        std::string pageScope; // innermost scope the page starts in
+        std::vector<Scope> scopes;
+        int nPages = 0;
+        long nLines = 0;
+        long firstLine = 1;
+        bool isIndex = false; // page holds text of the index, not a script
+
+        void printIndent();
+        void openScope(Scope const& scope, char const* suffix = "");
+        void append(std::string const& str);
+        void flushPage();
+        void flushIndex();
     };
 
+    //
+    // Nodes are written into the final graph, links into a side file
+    // that is appended to it at the end. The graph is then rendered by
+    // a dot process that the logger does not wait for, by default, so
+    // that the exit of a traced program is not held up. With
+    // Render::None it is left for the user to render.
+    //
+    // A call that repeats the previous call in the same scope event for
+    // event, up to the next call, is folded into it: the cluster is
+    // drawn once, labelled with the number of calls and their copies
+    // and moves.
+    // Past the node budget events are counted but not drawn.
+    //
+
     struct DotLogger : public Logger
     {
+        enum class Render
+        {
+            None,
+            Detached,
+            Blocking,
+        };
+
+        struct Options
+        {
+            Render render = Render::Detached;
+            char const* format = "png"; // any dot -T format: png, svg, pdf...
+            int dpi = 400;
+            bool fold = true;
+            int nodeBudget = 5000; // 0 draws every node
+        };
+
         DotLogger();
+        explicit DotLogger(Options const& options);
         virtual ~DotLogger();
 
-        virtual void enterFunction(std::string name);
+        virtual void enterFunction(int function);
         virtual void exitFunction() override;
         virtual void enterDTOR(TrackedInfo const& info);
         virtual void enterCTOR(TrackedInfo const& info);
@@ -190,12 +1250,16 @@ namespace Tracker
         virtual void enterAsgCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
         virtual void enterAsgMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
         virtual void enterAsgOper(TrackedInfo const& infoTo, TrackedInfo const& infoFrom, std::string const& oper);
+        virtual void enterAlloc(AllocInfo const& info) override;
+        virtual void exitAlloc(AllocInfo const& info) override;
+        virtual void enterLane(int lane) override;
 
     protected:
-        char const* nodesFilename = "dotfiles/trackerlog.nodes.dot";
         char const* linksFilename = "dotfiles/trackerlog.links.dot";
         char const* finalFilename  ="dotfiles/trackedlog.dot";
-        char const* imageFilename = "trackedlog.png";
+        char const* dotlogFilename = "dotfiles/dotlog.txt";
+        Options options;
+        std::string imageFilename; // trackedlog.<format>
         FILE* nodes; // goes 1st
         FILE* links; // goes 2nd
         
@@ -216,23 +1280,83 @@ namespace Tracker
             int index;
         };
 
+        //
+        // Output goes straight to the files. Only while an entry
+        // waits for its content are later writes held back, in
+        // order, and released once it is resolved.
+        //
+
         struct FileEntry
         {
             FILE* file;
             bool isResolved = true;
-            std::string content;
+            std::string content; // the entry name while unresolved
+        };
+
+        //
+        // Open cluster. A cluster is held in memory until it closes and
+        // can be compared with the next one, unless it outgrows
+        // foldBytes: then it and its parents are written out. The last
+        // closed child waits in held, together with the events of the
+        // caller that follow it, for the next one to end the same way.
+        // Frames are not used once lanes are.
+        //
+
+        struct Frame
+        {
+            int cluster = -1;
+            std::string label;
+            std::string style;
+            std::string signature;
+            std::string nodes;
+            std::string links;
+            std::string trailerNodes; // events of the caller up to its next call
+            std::string trailerLinks;
+            std::vector<Node> allocated; // drawn nodes, in order
+            int copies = 0;
+            int moves = 0;
+            int repeats = 1;
+            bool isBuffered = false;
+            bool isHidden = false; // opened past the node budget
+            std::unique_ptr<Frame> held;      // last closed child
+            std::unique_ptr<Frame> candidate; // the one after it
+        };
+
+        //
+        // Nodes of folded calls stand for the nodes of the call they
+        // were folded into. Only nodes that can still be linked to
+        // are kept: the first and the latest of live objects.
+        //
+
+        struct Redirect
+        {
+            Node first = { -1, -1 };
+            Node latest = { -1, -1 };
+            int latestIndex = -1;
         };
 
+        static std::size_t const bufferSize = 1 << 16;
+        static std::size_t const foldBytes = 1 << 20;
+
         int hypergraphs = 0;
-        std::map<int, int> nodeById;
+        std::map<int, int> nodeById; // of live objects
         // std::map<int, std::map<std::string, int>> operById;
         int nOpers = 0;
-        std::map<std::string, std::string> entryContentByName;
-        std::vector<FileEntry> entriesFlow;
+        int nUntracked = 0;
+        std::map<std::string, std::string> patches; // resolved entries by name
+        std::deque<FileEntry> pending;
         Node last = { -1, -1 };
+        std::map<int, Node> lastByLane;
+        std::map<int, std::vector<int>> clusters; // open clusters by lane
+        std::vector<Frame> frames = std::vector<Frame>(1); // the graph itself first
+        std::map<int, Redirect> redirects;
+        int drawn = 0;
+        long hidden = 0;
+        bool isOverBudget = false;
 
         Node allocNode(int id);
         Node currentNode(int id);
+        Node sourceNode(TrackedInfo const& info);
         void logInfo(TrackedInfo const& info, Node node, std::string const& reason, char const* color = "000000");
         void link(Node from, Node to, LinkType type);
         void linkExec(Node to);
@@ -242,31 +1366,452 @@ namespace Tracker
         void pushEntry(FILE* file, std::string const& entry);
         void setEntryContent(std::string const& entryName, char const* fmt, ...);
         void write(FILE* file, char const* fmt, ...);
-        void flushEntries();
+        void put(FILE* file, std::string const& text);
+        void output(FILE* file, std::string const& text);
+        void flushEntries(bool isFinal = false);
+        bool beginEvent(Node node, char const* tag);
+        void openFrame(std::string const& label, std::string const& style, std::string const& signature);
+        void closeFrame();
+        void compare(Frame& frame);
+        void settle(Frame& frame);
+        void emit(Frame& child, Frame& into);
+        void fold(Frame& child, Frame& into);
+        void stream(std::size_t upTo);
+        void limit();
+        static std::size_t bytes(Frame const& frame);
+        Frame* tail();
+        Node resolve(Node node) const;
+        void closeLane();
+        void appendLinks();
+        void render();
         void message(char const* fmt, ...);
     };
 
+    //
+    // One line per event with every id resolved to its name, so that
+    // streams of different builds of a program can be compared. The
+    // function column is the scope the event happened in.
+    //
+
+    struct CsvLogger : public Logger
+    {
+        CsvLogger(char const* filename = "trackerlog.csv");
+        virtual ~CsvLogger();
+
+        virtual void enterFunction(int function);
+        virtual void exitFunction() override;
+        virtual void enterDTOR(TrackedInfo const& info);
+        virtual void enterCTOR(TrackedInfo const& info);
+        virtual void enterCTORCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
+        virtual void enterCTORMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
+        virtual void enterAsg(TrackedInfo const& info);
+        virtual void enterAsgCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
+        virtual void enterAsgMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
+        virtual void enterAsgOper(TrackedInfo const& infoTo, TrackedInfo const& infoFrom, std::string const& oper);
+        virtual void enterAlloc(AllocInfo const& info) override;
+        virtual void exitAlloc(AllocInfo const& info) override;
+
+    protected:
+        FILE* file;
+
+        void writeEvent(char const* event, TrackedInfo const* info, TrackedInfo const* from = nullptr, std::uint64_t bytes = 0);
+        void writeAlloc(char const* event, AllocInfo const& info, std::uint64_t count);
+        void writeField(std::string const& field);
+    };
+
+    //
+    // Chrome trace event JSON, for ui.perfetto.dev or chrome://tracing.
+    // Scopes are slices of the lane's thread, every event on an object
+    // is an instant slice inside them. The lifetime of an object is an
+    // async span from its construction to its destruction, copies and
+    // moves are flow arrows from the slice that made the source.
+    //
+
+    struct ChromeTraceLogger : public Logger
+    {
+        static std::size_t const bufferSize = 1 << 20;
+        ChromeTraceLogger(char const* filename = "trackerlog.json");
+        virtual ~ChromeTraceLogger();
+
+        virtual void enterFunction(int function);
+        virtual void exitFunction() override;
+        virtual void enterDTOR(TrackedInfo const& info);
+        virtual void enterCTOR(TrackedInfo const& info);
+        virtual void enterCTORCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
+        virtual void enterCTORMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
+        virtual void enterAsg(TrackedInfo const& info);
+        virtual void enterAsgCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
+        virtual void enterAsgMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
+        virtual void enterAsgOper(TrackedInfo const& infoTo, TrackedInfo const& infoFrom, std::string const& oper);
+        virtual void enterAlloc(AllocInfo const& info) override;
+        virtual void exitAlloc(AllocInfo const& info) override;
+        virtual void enterLane(int lane) override;
+
+    protected:
+        struct Birth
+        {
+            std::uint64_t time;
+            int lane;
+        };
+
+        FILE* file;
+        std::string buffer;
+        std::uint64_t start = -1; // time of the first event
+        int nFlows = 0;
+        bool isFirst = true;
+        std::map<int, Birth> births; // of the live objects, by id
+        std::set<int> lanes;         // named
+
+        std::uint64_t now();
+        void number(long long value);
+        void open(char phase, std::uint64_t time, int tid);
+        void field(char const* key, std::string const& value);
+        void close();
+        void slice(std::uint64_t time, std::string const& event, TrackedInfo const& info, TrackedInfo const* from = nullptr);
+        void flow(std::uint64_t time, char const* kind, TrackedInfo const& from);
+        void born(std::uint64_t time, TrackedInfo const& info);
+        void flush();
+    };
+
+    //
+    // Folded stacks for flame graphs (flamegraph.pl, speedscope), one
+    // line per distinct stack of scopes with its weight: the wall time
+    // spent in its top scope itself, in ns, or the copies made there.
+    // Written when the logger is destroyed.
+    //
+
+    struct FlameLogger : public Logger
+    {
+        enum class Weight
+        {
+            Time,
+            Copies,
+        };
+
+        FlameLogger(Weight weight = Weight::Time, char const* filename = "trackerlog.folded");
+        virtual ~FlameLogger();
+
+        virtual void enterFunction(int function);
+        virtual void exitFunction() override;
+        virtual void enterDTOR(TrackedInfo const& info);
+        virtual void enterCTOR(TrackedInfo const& info);
+        virtual void enterCTORCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
+        virtual void enterCTORMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
+        virtual void enterAsg(TrackedInfo const& info);
+        virtual void enterAsgCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
+        virtual void enterAsgMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
+        virtual void enterAsgOper(TrackedInfo const& infoTo, TrackedInfo const& infoFrom, std::string const& oper);
+        virtual void enterLane(int lane) override;
+
+    protected:
+        //
+        // Stacks form a tree, a node is a stack. Scopes outside of
+        // any other are children of the lane, -1 - lane.
+        //
+
+        struct Node
+        {
+            int function;
+            int parent;
+            std::uint64_t weight;
+        };
+
+        struct Frame
+        {
+            int node;
+            std::uint64_t entered;
+            std::uint64_t nested; // in the scopes it called
+        };
+
+        Weight weight;
+        FILE* file;
+        std::vector<Node> nodes;
+        std::map<std::pair<int, int>, int> children; // by parent and function
+        std::map<int, std::vector<Frame>> lanes;     // open frames
+        std::vector<Frame>* frames;
+
+        int child(int parent, int function);
+        int top();
+        void addCopy();
+        void write(int node);
+    };
+
+    //
+    // Fixed-size binary image of one event
+    //
+
+    struct EventRecord
+    {
+        enum class Kind : std::uint8_t
+        {
+            Function,
+            ExitFunction,
+            DTOR,
+            CTOR,
+            CTORCopy,
+            CTORMove,
+            Asg,
+            AsgCopy,
+            AsgMove,
+            AsgOper,
+            Alloc,
+            ExitAlloc,
+        };
+
+        struct Object
+        {
+            int id;
+            int name;
+            int function;
+            int history;
+            std::uint32_t flags;
+            int type;
+            int site;
+            std::uint32_t bytes;
+            void* address;
+            TrackedValue value;
+        };
+
+        Kind kind;
+        char oper[4];
+        int function;
+        int lane;
+        std::uint64_t time;
+        Object to;
+        union
+        {
+            Object from = {};
+            AllocInfo alloc; // for Alloc and ExitAlloc
+        };
+    };
+
+    //
+    // Captures events into preallocated rings and replays them into
+    // the target logger from a background thread. Every thread that
+    // reports has a ring of its own, of capacity records, so producers
+    // never share one. The rings are drained in turn and thread
+    // switches are announced with enterLane(), as MergeLogger does;
+    // events of one thread keep their order, those of different
+    // threads are not merged by time. Events that do not fit into a
+    // ring are dropped and counted.
+    //
+
+    struct AsyncLogger : public Logger
+    {
+        AsyncLogger(Logger* target, std::size_t capacity = 1 << 16);
+        virtual ~AsyncLogger();
+
+        virtual void enterFunction(int function);
+        virtual void exitFunction() override;
+        virtual void enterDTOR(TrackedInfo const& info);
+        virtual void enterCTOR(TrackedInfo const& info);
+        virtual void enterCTORCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
+        virtual void enterCTORMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
+        virtual void enterAsg(TrackedInfo const& info);
+        virtual void enterAsgCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
+        virtual void enterAsgMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
+        virtual void enterAsgOper(TrackedInfo const& infoTo, TrackedInfo const& infoFrom, std::string const& oper);
+        virtual void enterAlloc(AllocInfo const& info) override;
+        virtual void exitAlloc(AllocInfo const& info) override;
+        virtual void attach(MainLoggerBase const* owner) override;
+
+        std::size_t queued() const;
+        std::size_t dropped() const;
+
+    protected:
+        struct Producer
+        {
+            int lane;
+            std::vector<EventRecord> ring; // allocated on the first event
+            alignas(64) std::atomic<std::size_t> head = 0; // drain thread
+            alignas(64) std::atomic<std::size_t> tail = 0; // owning thread
+            std::vector<bool> scopeKept;
+            ScopeStack calls; // replayed on the drain thread
+        };
+
+        Logger* target;
+        std::size_t mask;
+        PerThread<Producer> producers;
+        alignas(64) std::atomic<std::size_t> nDropped = 0;
+        std::atomic<bool> isRunning = true;
+        std::thread drain;
+
+        Producer& producer();
+        EventRecord* reserve(Producer& producer, EventRecord::Kind kind);
+        void commit(Producer& producer);
+        void record(EventRecord::Kind kind, TrackedInfo const& infoTo, TrackedInfo const* infoFrom = nullptr);
+        void drainLoop();
+    };
+
+    //
+    // Thread-safe wrapper: every thread appends timestamped records
+    // to its own buffer. flush() merges the buffers into one stream
+    // ordered by time and replays it into the target, announcing
+    // thread switches with enterLane(). Call flush() only while the
+    // tracked threads are quiescent; the destructor flushes too.
+    //
+
+    struct MergeLogger : public Logger
+    {
+        MergeLogger(Logger* target);
+        virtual ~MergeLogger();
+
+        virtual void enterFunction(int function);
+        virtual void exitFunction() override;
+        virtual void enterDTOR(TrackedInfo const& info);
+        virtual void enterCTOR(TrackedInfo const& info);
+        virtual void enterCTORCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
+        virtual void enterCTORMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
+        virtual void enterAsg(TrackedInfo const& info);
+        virtual void enterAsgCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
+        virtual void enterAsgMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
+        virtual void enterAsgOper(TrackedInfo const& infoTo, TrackedInfo const& infoFrom, std::string const& oper);
+        virtual void enterAlloc(AllocInfo const& info) override;
+        virtual void exitAlloc(AllocInfo const& info) override;
+        virtual void attach(MainLoggerBase const* owner) override;
+
+        void flush();
+
+    protected:
+        struct Buffer
+        {
+            int lane;
+            std::vector<EventRecord> records;
+        };
+
+        Logger* target;
+        PerThread<Buffer> buffers;
+        std::map<int, ScopeStack> laneCalls;
+
+        EventRecord& record(EventRecord::Kind kind);
+        void record(EventRecord::Kind kind, TrackedInfo const& infoTo, TrackedInfo const* infoFrom = nullptr);
+    };
+
+    //
+    // Binary event stream for rendering offline: a fixed-layout record
+    // per event, preceded by the strings and type traits it refers to
+    // when they are new. Nothing is formatted while tracking. Read it
+    // back with TraceReader or tracker_convert. Not thread-safe, wrap
+    // it into a MergeLogger for several threads.
+    //
+
+    struct TraceLogger : public Logger
+    {
+        static std::size_t const bufferSize = 1 << 20;
+        TraceLogger(char const* filename = "trackerlog.trk");
+        virtual ~TraceLogger();
+
+        virtual void enterFunction(int function);
+        virtual void exitFunction() override;
+        virtual void enterDTOR(TrackedInfo const& info);
+        virtual void enterCTOR(TrackedInfo const& info);
+        virtual void enterCTORCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
+        virtual void enterCTORMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
+        virtual void enterAsg(TrackedInfo const& info);
+        virtual void enterAsgCopy(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
+        virtual void enterAsgMove(TrackedInfo const& infoTo, TrackedInfo const& infoFrom);
+        virtual void enterAsgOper(TrackedInfo const& infoTo, TrackedInfo const& infoFrom, std::string const& oper);
+        virtual void enterAlloc(AllocInfo const& info) override;
+        virtual void exitAlloc(AllocInfo const& info) override;
+        virtual void enterLane(int lane) override;
+
+    protected:
+        FILE* file;
+        std::string buffer;
+        int known[4] = {}; // strings written, by table
+
+        void put(void const* data, std::size_t size);
+        void putTag(EventRecord::Kind kind);
+        void reference(int table, int id);
+        void reference(TrackedInfo const& info);
+        void putEvent(EventRecord::Kind kind, TrackedInfo const& infoTo, TrackedInfo const* infoFrom = nullptr, std::string const& oper = "");
+        void putAlloc(EventRecord::Kind kind, AllocInfo const& info);
+        void flush();
+    };
+
+    //
+    // A .trk file mapped into memory. replay() delivers its events to
+    // target in order, with ids mapped into the tables of this process.
+    // The reader is the owner of target: the counters of the summary
+    // are rebuilt from the events of the trace. A trace cut short, by
+    // a crash for one, is replayed up to its last whole record.
+    //
+
+    struct TraceReader : public MainLoggerBase
+    {
+        explicit TraceReader(char const* filename);
+        ~TraceReader();
+
+        std::size_t replay(Logger& target); // events delivered
+
+    protected:
+        std::string filename;
+        char const* data;
+        std::size_t size;
+        std::vector<int> ids[4]; // of this process, by table and id in the trace
+
+        int local(int table, int id) const;
+    };
+
     extern MainLogger mainLogger;
 
+    //
+    // Scopes entered while tracking is off are not stacked, timed or
+    // delivered, their exits are skipped as well
+    //
+
+    template <typename Dispatcher>
     struct FncEnvoy
     {
-        FncEnvoy(std::string name)
+        FncEnvoy(Dispatcher& dispatcher, int function, int site = -1) :
+            dispatcher(dispatcher),
+            isEntered(dispatcher.enabled())
         {
-            mainLogger.enterFunction(name);
+            if (isEntered)
+                dispatcher.enterFunction(function, site);
         }
 
         ~FncEnvoy()
         {
-            mainLogger.exitFunction();
+            if (isEntered)
+                dispatcher.exitFunction();
         }
+
+    private:
+        Dispatcher& dispatcher;
+        bool isEntered;
     };
 }
 
+//
+// Builds that define TRACKER_CSV, TRACKER_TRACE, TRACKER_CHROME or
+// TRACKER_FLAME as a file name log only to it
+//
+
+#if defined(TRACKER_CSV)
+#define TRACKER_DEFAULT_INITIALIZATION  Tracker::mainLogger.addNewLogger(new Tracker::CsvLogger(TRACKER_CSV))
+#elif defined(TRACKER_TRACE)
+#define TRACKER_DEFAULT_INITIALIZATION  Tracker::mainLogger.addNewLogger(new Tracker::TraceLogger(TRACKER_TRACE))
+#elif defined(TRACKER_CHROME)
+#define TRACKER_DEFAULT_INITIALIZATION  Tracker::mainLogger.addNewLogger(new Tracker::ChromeTraceLogger(TRACKER_CHROME))
+#elif defined(TRACKER_FLAME)
+#define TRACKER_DEFAULT_INITIALIZATION  Tracker::mainLogger.addNewLogger(new Tracker::FlameLogger(Tracker::FlameLogger::Weight::Time, TRACKER_FLAME))
+#else
 #define TRACKER_DEFAULT_INITIALIZATION  Tracker::mainLogger.addNewLogger(new Tracker::ConsoleLogger); \
                                         Tracker::mainLogger.addNewLogger(new Tracker::HtmlLogger); \
                                         Tracker::mainLogger.addNewLogger(new Tracker::DotLogger)
-#define TRACKER_ENTER Tracker::FncEnvoy __envoy(__PRETTY_FUNCTION__)
+#endif
+#if TRACKER_LEVEL >= TRACKER_LEVEL_SCOPES
+#define TRACKER_ENTER static int const __function = Tracker::internFunction(__PRETTY_FUNCTION__); \
+                      static int const __site = Tracker::internSite(__FILE__, __LINE__); \
+                      Tracker::FncEnvoy __envoy(TRACKER_DISPATCHER, __function, __site)
+#else
+#define TRACKER_ENTER ((void)0)
+#endif
 #define TRACKER_CREATE(type, name, init) type name(init, #name)
-#define TRACKER_ON Tracker::mainLogger.on()
-#define TRACKER_OFF Tracker::mainLogger.off()
+#define TRACKER_SITE Tracker::Site site = {}
+#define TRACKER_CALL(...) ([&]() -> decltype(auto) { Tracker::CallSite __callSite({ {}, __FILE__, __LINE__ }); \
+                                                     return __VA_ARGS__; }())
+#define TRACKER_ON TRACKER_DISPATCHER.on()
+#define TRACKER_OFF TRACKER_DISPATCHER.off()
 #endif
\ No newline at end of file
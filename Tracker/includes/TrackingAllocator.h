@@ -0,0 +1,188 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    TrackingAllocator.h
+
+Abstract:
+
+    Allocator that reports the blocks of std containers, so that
+    element copies are seen next to the growth that caused them.
+
+Author / Creation date:
+
+    JulesIMF / 26.03.22
+
+Revision History:
+
+--*/
+
+#ifndef TRACKER_TRACKING_ALLOCATOR
+#define TRACKER_TRACKING_ALLOCATOR
+
+//
+// Includes / usings
+//
+
+#include <Tracker.h>
+#include <new>
+
+//
+// Defines
+//
+
+namespace Tracker
+{
+    //
+    // Remembers the last block it handed out. Allocating a block of
+    // another size while that one is live is a reallocation: the
+    // window stays open until the old block is released, so a vector's
+    // relocation ends up inside it. A moved-to allocator takes the
+    // block over. A copy follows the same block and compares equal to
+    // its source; allocators following different blocks are not equal,
+    // even though either could free the other's memory. A copied
+    // container starts a new allocator with no block.
+    //
+    // Blocks and relocations are attributed to the container call
+    // wrapped in TRACKER_CALL, to the enclosing TRACKER_ENTER without
+    // one:
+    //
+    //     TRACKER_CALL(vector.push_back(value));
+    //
+
+    template <typename T>
+    struct TrackingAllocator
+    {
+        using value_type = T;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+        using is_always_equal = std::false_type;
+
+        TrackingAllocator() noexcept = default;
+        TrackingAllocator(TrackingAllocator const&) noexcept = default;
+
+        template <typename U>
+        TrackingAllocator(TrackingAllocator<U> const&) noexcept
+        {
+        }
+
+        TrackingAllocator(TrackingAllocator&& other) noexcept
+        {
+            take(other);
+        }
+
+        TrackingAllocator& operator=(TrackingAllocator const&) noexcept = default;
+
+        TrackingAllocator& operator=(TrackingAllocator&& other) noexcept
+        {
+            take(other);
+            return *this;
+        }
+
+        T* allocate(std::size_t n)
+        {
+            auto pointer = static_cast<T*>(::operator new(n * sizeof(T)));
+
+            TRACKER_IF(LIFETIMES)
+            {
+                bool isRealloc = block && n != count && !isGrowing;
+                if (isRealloc)
+                {
+                    previous = block;
+                    previousCount = count;
+                    isGrowing = true;
+                }
+
+                auto info = describe(isRealloc ? AllocInfo::Kind::Realloc : AllocInfo::Kind::Alloc, pointer, n);
+                TRACKER_DISPATCHER.enterAlloc(info);
+            }
+
+            block = pointer;
+            count = n;
+            return pointer;
+        }
+
+        void deallocate(T* pointer, std::size_t n) noexcept
+        {
+            if (isGrowing && pointer == previous)
+            {
+                auto info = describe(AllocInfo::Kind::Realloc, block, count);
+                TRACKER_DISPATCHER.exitAlloc(info);
+                previous = nullptr;
+                isGrowing = false;
+            }
+
+            else
+            {
+                TRACKER_IF(LIFETIMES)
+                {
+                    auto info = describe(AllocInfo::Kind::Free, pointer, n);
+                    TRACKER_DISPATCHER.enterAlloc(info);
+                }
+
+                if (pointer == block)
+                    block = nullptr;
+            }
+
+            ::operator delete(pointer);
+        }
+
+        TrackingAllocator select_on_container_copy_construction() const noexcept
+        {
+            return {};
+        }
+
+        template <typename U>
+        bool operator==(TrackingAllocator<U> const& other) const noexcept
+        {
+            return static_cast<void const*>(block) == static_cast<void const*>(other.block);
+        }
+
+        template <typename U>
+        bool operator!=(TrackingAllocator<U> const& other) const noexcept
+        {
+            return !(*this == other);
+        }
+
+    private:
+        template <typename U>
+        friend struct TrackingAllocator;
+
+        T* block = nullptr;
+        std::size_t count = 0;
+        T* previous = nullptr;
+        std::size_t previousCount = 0;
+        bool isGrowing = false;
+
+        void take(TrackingAllocator& other) noexcept
+        {
+            block = other.block;
+            count = other.count;
+            previous = other.previous;
+            previousCount = other.previousCount;
+            isGrowing = other.isGrowing;
+            other.block = other.previous = nullptr;
+            other.count = other.previousCount = 0;
+            other.isGrowing = false;
+        }
+
+        AllocInfo describe(AllocInfo::Kind kind, T* address, std::size_t n) const
+        {
+            AllocInfo info = {};
+            info.kind = kind;
+            info.flags = std::is_nothrow_move_constructible_v<T> ? 0 : AllocInfo::ThrowingMove;
+            info.type = typeId<T>();
+            info.site = TRACKER_DISPATCHER.callSite();
+            info.size = sizeof(T);
+            info.count = n;
+            info.previousCount = previousCount;
+            info.address = address;
+            info.previous = previous;
+            return info;
+        }
+    };
+}
+
+#endif // !TRACKER_TRACKING_ALLOCATOR
@@ -0,0 +1,48 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Record.h
+
+Abstract:
+
+    Conversion between events and EventRecords.
+
+Author / Creation date:
+
+    JulesIMF / 14.03.22
+
+Revision History:
+
+--*/
+
+#ifndef TRACKER_RECORD
+#define TRACKER_RECORD
+
+//
+// Includes / usings
+//
+
+#include <Tracker.h>
+
+//
+// Defines
+//
+
+namespace Tracker
+{
+    void encode(EventRecord::Object& object, TrackedInfo const& info);
+    void encodeOper(EventRecord& record, std::string const& oper);
+
+    //
+    // Calls the hook of target that produced record. Scope and
+    // window records update ScopeStack::current of the calling thread,
+    // every record sets its time.
+    //
+
+    void replay(Logger& target, EventRecord const& record);
+}
+
+#endif // !TRACKER_RECORD
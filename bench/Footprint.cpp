@@ -0,0 +1,120 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Footprint.cpp
+
+Abstract:
+
+    Reports the size of a tracked Int and the cache
+    footprint of arrays of them, compared with the
+    string-based TrackedInfo layout and a plain int.
+
+Author / Creation date:
+
+    JulesIMF / 18.03.22
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#define TRACKER_DISPATCHER footprintTracker
+#include <Tracker.h>
+
+Tracker::BasicMainLogger<Tracker::NullLogger> footprintTracker;
+
+#include "Int.h"
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+//
+// Defines
+//
+
+//
+// TrackedInfo as it was with inline strings
+//
+
+struct LegacyTrackedInfo
+{
+    int id;
+    void* address;
+    std::string name;
+    std::string value;
+    std::string history;
+    std::string function;
+    bool isTemp = false;
+};
+
+struct LegacyInt
+{
+    int value;
+    LegacyTrackedInfo info;
+
+    int get() const
+    {
+        return value;
+    }
+};
+
+template <typename T>
+double nsPerElement(std::vector<T> const& array, int passes)
+{
+    auto start = std::chrono::steady_clock::now();
+    long long sum = 0;
+    for (int pass = 0; pass != passes; pass++)
+    {
+        for (auto const& element : array)
+        {
+            if constexpr (std::is_same_v<T, int>)
+                sum += element;
+            else
+                sum += element.get();
+        }
+    }
+
+    auto finish = std::chrono::steady_clock::now();
+    volatile long long sink = sum;
+    (void)sink;
+    return std::chrono::duration<double, std::nano>(finish - start).count() / (double(passes) * array.size());
+}
+
+template <typename T>
+void report(char const* name, std::vector<T> const& array, int passes)
+{
+    static std::size_t const cacheLine = 64;
+    std::size_t bytes = sizeof(T) * array.size();
+    printf("%-12s %8zu %12zu %12zu %10.3f\n", name, sizeof(T), bytes, (bytes + cacheLine - 1) / cacheLine, nsPerElement(array, passes));
+}
+
+int main()
+{
+    static int const n = 1 << 20;
+    static int const passes = 16;
+
+    printf("sizeof(TrackedInfo) = %zu (was %zu)\n", sizeof(Tracker::TrackedInfo), sizeof(LegacyTrackedInfo));
+    printf("sizeof(Int)         = %zu (was %zu)\n\n", sizeof(Int), sizeof(LegacyInt));
+
+    std::vector<int> plain(n, 1);
+    std::vector<LegacyInt> legacy(n);
+    for (auto& element : legacy)
+        element.value = 1;
+
+    std::vector<Int> tracked;
+    tracked.reserve(n);
+    for (int i = 0; i != n; i++)
+        tracked.emplace_back(1);
+
+    printf("%-12s %8s %12s %12s %10s\n", "layout", "sizeof", "bytes", "lines", "ns/elem");
+    report("int", plain, passes);
+    report("Int (was)", legacy, passes);
+    report("Int", tracked, passes);
+}
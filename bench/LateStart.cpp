@@ -0,0 +1,50 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    LateStart.cpp
+
+Abstract:
+
+    Objects made while tracking is off and modified once it is on:
+    they are named on their first event, every sink must accept them.
+    Built at every TRACKER_LEVEL by "make levels".
+
+Author / Creation date:
+
+    JulesIMF / 05.04.22
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <Tracker.h>
+#include "Int.h"
+
+//
+// Defines
+//
+
+int main()
+{
+    TRACKER_DEFAULT_INITIALIZATION;
+    TRACKER_OFF;
+    Int early;
+    Int source = 1;
+    TRACKER_ON;
+
+    TRACKER_ENTER;
+    TRACKER_CREATE(Int, b, 2);
+    early = b;
+    early += b;
+    early = 5;
+    early = std::move(source);
+    TRACKER_OFF;
+}
@@ -0,0 +1,297 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Overhead.cpp
+
+Abstract:
+
+    Time per tracked event for every sink, with tracking turned
+    off and for a plain int doing the same work.
+
+    Usage: tracker_bench [--csv]
+
+Author / Creation date:
+
+    JulesIMF / 30.03.22
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#define TRACKER_DISPATCHER benchTracker
+#include <Tracker.h>
+
+//
+// Sink of the dispatcher, the logger under test is swapped per run
+//
+
+struct BenchLogger : public Tracker::DynamicLogger
+{
+    Tracker::Logger* release()
+    {
+        auto logger = loggers.empty() ? nullptr : loggers.back();
+        loggers.clear();
+        return logger;
+    }
+};
+
+Tracker::BasicMainLogger<BenchLogger> benchTracker;
+
+#include "Int.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+//
+// Defines
+//
+
+static int const repetitions = 3;
+static int const nValues = 1024;
+
+template <typename T>
+inline void keep(T const& value)
+{
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+template <typename Body>
+double measure(int n, Body body)
+{
+    double best = 1e300;
+    for (int repetition = 0; repetition != repetitions; repetition++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i != n; i++)
+            body(i);
+
+        auto finish = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::nano>(finish - start).count() / n);
+    }
+
+    return best;
+}
+
+__attribute__((noinline)) void trackedCall()
+{
+    TRACKER_ENTER;
+}
+
+__attribute__((noinline)) void plainCall()
+{
+    asm volatile("");
+}
+
+//
+// Every operation is timed on Int and on int
+//
+
+template <typename T>
+double construct(int n)
+{
+    return measure(n, [](int i)
+    {
+        T value(i);
+        keep(value);
+    });
+}
+
+template <typename T>
+double copy(int n)
+{
+    T source(1);
+    return measure(n, [&](int)
+    {
+        T value(source);
+        keep(value);
+    });
+}
+
+template <typename T>
+double move(int n)
+{
+    T source(1);
+    return measure(n, [&](int)
+    {
+        T value(std::move(source));
+        keep(value);
+    });
+}
+
+template <typename T>
+double call(int n)
+{
+    return measure(n, [](int)
+    {
+        if constexpr (std::is_same_v<T, int>)
+            plainCall();
+        else
+            trackedCall();
+    });
+}
+
+template <typename T>
+double sum(int n)
+{
+    std::vector<T> values;
+    values.reserve(nValues);
+    for (int i = 0; i != nValues; i++)
+        values.emplace_back(i);
+
+    T result(0);
+    auto ns = measure(n, [&](int i)
+    {
+        result += values[i % nValues];
+        keep(result);
+    });
+
+    return ns;
+}
+
+struct Operation
+{
+    char const* name;
+    double (*tracked)(int n);
+    double (*plain)(int n);
+};
+
+static Operation const operations[] =
+{
+    { "ctor+dtor",  construct<Int>, construct<int> },
+    { "copy+dtor",  copy<Int>,      copy<int> },
+    { "move+dtor",  move<Int>,      move<int> },
+    { "enter+exit", call<Int>,      call<int> },
+    { "sum loop",   sum<Int>,       sum<int> },
+};
+
+static int const nOperations = sizeof(operations) / sizeof(operations[0]);
+
+//
+// Text sinks and the graph write every event, they get fewer
+// iterations. The graph is not rendered: that is not a per-event
+// cost and takes minutes on a graph this size. It is measured with
+// every node kept, and with the default budget next to it.
+//
+
+static Tracker::Logger* newDotLogger(int nodeBudget)
+{
+    Tracker::DotLogger::Options options;
+    options.render = Tracker::DotLogger::Render::None;
+    options.nodeBudget = nodeBudget;
+    return new Tracker::DotLogger(options);
+}
+
+struct Configuration
+{
+    char const* name;
+    int n;
+    Tracker::Logger* (*create)();
+    bool isOn;
+};
+
+static Configuration const configurations[] =
+{
+    { "off",      1 << 20, []() -> Tracker::Logger* { return nullptr; },                        false },
+    { "none",     1 << 18, []() -> Tracker::Logger* { return nullptr; },                        true },
+    { "console",  1 << 15, []() -> Tracker::Logger* { return new Tracker::ConsoleLogger; },     true },
+    { "html",     1 << 15, []() -> Tracker::Logger* { return new Tracker::HtmlLogger; },        true },
+    { "dot",      1 << 12, []() -> Tracker::Logger* { return newDotLogger(0); },                true },
+    { "dot 5000", 1 << 12, []() -> Tracker::Logger* { return newDotLogger(5000); },             true },
+    { "trace",    1 << 18, []() -> Tracker::Logger* { return new Tracker::TraceLogger; },       true },
+    { "chrome",   1 << 15, []() -> Tracker::Logger* { return new Tracker::ChromeTraceLogger; }, true },
+    { "flame",    1 << 18, []() -> Tracker::Logger* { return new Tracker::FlameLogger; },       true },
+};
+
+static int const nConfigurations = sizeof(configurations) / sizeof(configurations[0]);
+
+static void run(Configuration const& configuration, double* results)
+{
+    bool isConsole = !strcmp(configuration.name, "console");
+    int savedStdout = -1;
+    if (isConsole)
+    {
+        fflush(stdout);
+        savedStdout = dup(STDOUT_FILENO);
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        close(null);
+    }
+
+    auto logger = configuration.create();
+    if (logger)
+        benchTracker.sink<BenchLogger>().addNewLogger(logger);
+
+    if (configuration.isOn)
+        TRACKER_ON;
+    else
+        TRACKER_OFF;
+
+    for (int i = 0; i != nOperations; i++)
+        results[i] = operations[i].tracked(configuration.n);
+
+    TRACKER_OFF;
+    benchTracker.sink<BenchLogger>().release();
+    delete logger;
+
+    if (isConsole)
+    {
+        fflush(stdout);
+        dup2(savedStdout, STDOUT_FILENO);
+        close(savedStdout);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bool isCsv = argc > 1 && !strcmp(argv[1], "--csv");
+    mkdir("dotfiles", 0755);
+
+    double plain[nOperations] = {};
+    double tracked[nConfigurations][nOperations] = {};
+
+    for (int i = 0; i != nOperations; i++)
+        plain[i] = operations[i].plain(1 << 20);
+
+    for (int i = 0; i != nConfigurations; i++)
+        run(configurations[i], tracked[i]);
+
+    if (isCsv)
+    {
+        printf("operation,sink,ns\n");
+        for (int i = 0; i != nOperations; i++)
+        {
+            printf("%s,int,%.2f\n", operations[i].name, plain[i]);
+            for (int j = 0; j != nConfigurations; j++)
+                printf("%s,%s,%.2f\n", operations[i].name, configurations[j].name, tracked[j][i]);
+        }
+
+        return 0;
+    }
+
+    printf("ns per operation, best of %d\n\n", repetitions);
+    printf("%-12s %10s", "operation", "int");
+    for (int j = 0; j != nConfigurations; j++)
+        printf(" %10s", configurations[j].name);
+
+    printf("\n");
+    for (int i = 0; i != nOperations; i++)
+    {
+        printf("%-12s %10.2f", operations[i].name, plain[i]);
+        for (int j = 0; j != nConfigurations; j++)
+            printf(" %10.2f", tracked[j][i]);
+
+        printf("\n");
+    }
+}
@@ -0,0 +1,152 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Relocation.cpp
+
+Abstract:
+
+    Grows vectors of Tracked elements through TrackingAllocator and
+    checks what the relocation report says: elements with noexcept
+    moves are moved, a type with a throwing move is copied and is the
+    only one reported. Copies and moves made inside std::vector
+    are attributed to the line of its call. Exits with 1 if the
+    report is wrong.
+
+Author / Creation date:
+
+    JulesIMF / 04.04.22
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#define TRACKER_DISPATCHER relocationTracker
+#include <Tracker.h>
+
+Tracker::BasicMainLogger<Tracker::NullLogger> relocationTracker;
+
+#include <Tracked.h>
+#include <TrackingAllocator.h>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+//
+// Defines
+//
+
+static int const nElements = 100;
+
+//
+// Move that may throw: a vector keeps its strong guarantee by copying
+//
+
+struct Throwing
+{
+    int value = 0;
+
+    Throwing() = default;
+    Throwing(int value) : value(value) {}
+    Throwing(Throwing const&) = default;
+    Throwing(Throwing&& other) : value(other.value) {}
+    Throwing& operator=(Throwing const&) = default;
+    Throwing& operator=(Throwing&& other) { value = other.value; return *this; }
+};
+
+struct Relocations
+{
+    std::uint64_t reallocs;
+    std::uint64_t copies;
+    std::uint64_t moves;
+    int site;
+};
+
+template <typename T>
+Relocations grow(T const& value)
+{
+    auto before = relocationTracker.getCounters().allocations();
+    int site = -1;
+
+    {
+        std::vector<Tracker::Tracked<T>, Tracker::TrackingAllocator<Tracker::Tracked<T>>> vector;
+        for (int i = 0; i != nElements; i++)
+            TRACKER_CALL(site = Tracker::CallSite::current, vector.push_back(Tracker::Tracked<T>(value)));
+    }
+
+    auto after = relocationTracker.getCounters().allocations();
+    return { after.reallocs - before.reallocs, after.copies - before.copies, after.moves - before.moves, site };
+}
+
+//
+// Every copy, move and relocation happened on the line of a push_back
+//
+
+static bool isAttributed(std::vector<int> const& sites)
+{
+    using Type = Tracker::ModificationType;
+    static std::size_t const nSites = 16;
+
+    auto counters = relocationTracker.getCounters();
+    auto attributed = counters.topSites({ Type::CTORCopy, Type::CTORMove }, nSites);
+    auto relocations = counters.topRelocationSites(nSites);
+    attributed.insert(attributed.end(), relocations.begin(), relocations.end());
+
+    bool isPassed = true;
+    for (auto const& entry : attributed)
+    {
+        if (std::find(sites.begin(), sites.end(), entry.id) != sites.end())
+            continue;
+
+        printf("attributed to %s  FAILED\n", Tracker::siteName(entry.id).c_str());
+        isPassed = false;
+    }
+
+    return isPassed;
+}
+
+static bool isThrowing(int type)
+{
+    auto throwing = Tracker::throwingMoveTypes();
+    return std::find(throwing.begin(), throwing.end(), type) != throwing.end();
+}
+
+static bool check(char const* name, Relocations const& relocations, bool isCopied, int type)
+{
+    bool isReported = isThrowing(type);
+    bool isPassed = relocations.reallocs != 0 && (relocations.copies != 0) == isCopied && isReported == isCopied;
+
+    printf("%-14s %8llu %8llu %8llu %10s  %s\n", name,
+           (unsigned long long)relocations.reallocs,
+           (unsigned long long)relocations.copies,
+           (unsigned long long)relocations.moves,
+           isReported ? "throwing" : "noexcept",
+           isPassed ? "ok" : "FAILED");
+
+    return isPassed;
+}
+
+int main()
+{
+    printf("%-14s %8s %8s %8s %10s\n", "element", "reallocs", "copies", "moves", "move");
+
+    auto ints = grow(1);
+    auto strings = grow(std::string(32, 'x'));
+    auto throwings = grow(Throwing(1));
+
+    bool isPassed = true;
+    isPassed &= check("int", ints, false, Tracker::typeId<int>());
+    isPassed &= check("std::string", strings, false, Tracker::typeId<std::string>());
+    isPassed &= check("Throwing", throwings, true, Tracker::typeId<Throwing>());
+    isPassed &= isAttributed({ ints.site, strings.site, throwings.site });
+
+    return isPassed ? 0 : 1;
+}
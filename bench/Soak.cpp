@@ -0,0 +1,243 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Soak.cpp
+
+Abstract:
+
+    Drives a long trace through every sink that streams and checks
+    that the resident set stops growing. History is bounded, as it
+    has to be in a long-lived process. Exits with 1 if a sink keeps
+    growing.
+
+    Usage: tracker_soak [iterations]
+
+Author / Creation date:
+
+    JulesIMF / 31.03.22
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#define TRACKER_DISPATCHER soakTracker
+#include <Tracker.h>
+
+//
+// Sink of the dispatcher, the logger under test is swapped per run
+//
+
+struct SoakLogger : public Tracker::DynamicLogger
+{
+    void clear()
+    {
+        for (auto logger : loggers)
+            delete logger;
+
+        loggers.clear();
+    }
+};
+
+Tracker::BasicMainLogger<SoakLogger> soakTracker;
+
+#include "Int.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+//
+// Defines
+//
+
+static std::size_t const historyLimit = 1 << 16;
+static int const nSamples = 32;
+static long const slack = 4 << 20; // bytes
+
+static long residentBytes()
+{
+    long pages = 0;
+    long resident = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm == nullptr)
+        return 0;
+
+    if (fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+        resident = 0;
+
+    fclose(statm);
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+//
+// One of every event class: 12 events
+//
+
+__attribute__((noinline)) void step(Int& accumulator, int i)
+{
+    TRACKER_ENTER;
+    Int value(i % 1000);
+    Int copy(value);
+    Int moved(std::move(copy));
+    accumulator = moved;
+    accumulator += value;
+    moved = i;
+    accumulator = std::move(moved);
+}
+
+static int const eventsPerStep = 12;
+
+//
+// Pages of the html log are dropped, it is the memory of the
+// writer that is measured
+//
+
+struct SoakHtmlLogger : public Tracker::HtmlLogger
+{
+    virtual ~SoakHtmlLogger()
+    {
+        flushPage(); // the last one, while writePage is still this one
+    }
+
+protected:
+    virtual void writePage(int, std::string const&) override
+    {
+    }
+};
+
+//
+// Text sinks write to /dev/null: the trace is gigabytes
+// and only the memory of the process matters. The graph
+// keeps every node, a budget would hide its growth.
+//
+
+static Tracker::Logger* newDotLogger()
+{
+    Tracker::DotLogger::Options options;
+    options.render = Tracker::DotLogger::Render::None;
+    options.nodeBudget = 0;
+    return new Tracker::DotLogger(options);
+}
+
+struct Configuration
+{
+    char const* name;
+    Tracker::Logger* (*create)();
+};
+
+static Configuration const configurations[] =
+{
+    { "none",          []() -> Tracker::Logger* { return nullptr; } },
+    { "console",       []() -> Tracker::Logger* { return new Tracker::ConsoleLogger; } },
+    { "html",          []() -> Tracker::Logger* { return new SoakHtmlLogger; } },
+    { "async console", []() -> Tracker::Logger* { return new Tracker::AsyncLogger(new Tracker::ConsoleLogger); } },
+    { "dot",           []() -> Tracker::Logger* { return newDotLogger(); } },
+    { "trace",         []() -> Tracker::Logger* { return new Tracker::TraceLogger; } },
+    { "chrome",        []() -> Tracker::Logger* { return new Tracker::ChromeTraceLogger; } },
+    { "flame",         []() -> Tracker::Logger* { return new Tracker::FlameLogger; } },
+};
+
+static bool soak(Configuration const& configuration, long iterations)
+{
+    fflush(stdout);
+    int savedStdout = dup(STDOUT_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    close(null);
+
+    auto logger = configuration.create();
+    if (logger)
+        soakTracker.sink<SoakLogger>().addNewLogger(logger);
+
+    std::vector<long> samples;
+    {
+        Int accumulator(0);
+        for (int sample = 0; sample != nSamples; sample++)
+        {
+            for (long i = 0; i != iterations / nSamples; i++)
+                step(accumulator, i);
+
+            samples.push_back(residentBytes());
+        }
+    }
+
+    soakTracker.sink<SoakLogger>().clear();
+    fflush(stdout);
+    dup2(savedStdout, STDOUT_FILENO);
+    close(savedStdout);
+
+    //
+    // The first quarter is the warm-up: the history ring fills,
+    // tables and buffers reach their size. After it the peak may
+    // not move by more than the slack.
+    //
+
+    long warm = 0;
+    long peak = 0;
+    for (int i = 0; i != nSamples; i++)
+    {
+        if (i < nSamples / 4)
+            warm = std::max(warm, samples[i]);
+        else
+            peak = std::max(peak, samples[i]);
+    }
+
+    bool isBounded = peak <= warm + slack;
+    printf("%-14s %12ld %10.1f %10.1f %10.1f  %s\n", configuration.name,
+           iterations / nSamples * nSamples * eventsPerStep,
+           samples.front() / 1048576.0, warm / 1048576.0, peak / 1048576.0,
+           isBounded ? "ok" : "GROWS");
+
+    return isBounded;
+}
+
+int main(int argc, char** argv)
+{
+    long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+
+    //
+    // File sinks open their files by name
+    //
+
+    static char const* const sinkFiles[] =
+    {
+        "trackerlog.html",
+        "dotfiles/trackedlog.dot",
+        "dotfiles/trackerlog.links.dot",
+        "trackerlog.trk",
+        "trackerlog.json",
+        "trackerlog.folded",
+    };
+
+    mkdir("dotfiles", 0755);
+    for (auto file : sinkFiles)
+    {
+        unlink(file);
+        if (symlink("/dev/null", file))
+            perror("tracker_soak: symlink");
+    }
+
+    soakTracker.setHistoryLimit(historyLimit);
+
+    printf("%-14s %12s %10s %10s %10s\n", "sink", "events", "first MB", "warm MB", "peak MB");
+    bool isBounded = true;
+    for (auto const& configuration : configurations)
+        isBounded &= soak(configuration, iterations);
+
+    for (auto file : sinkFiles)
+        unlink(file);
+
+    rmdir("trackerlog");
+    return isBounded ? 0 : 1;
+}
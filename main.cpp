@@ -43,6 +43,23 @@ T construct_from(T&& origin)
     return T(origin);
 }
 
+//
+// Copy elision, moves or copies depending on the build (make variants)
+//
+
+Int make_named()
+{
+    TRACKER_ENTER;
+    TRACKER_CREATE(Int, named, 1);
+    return named;
+}
+
+void consume(Int value)
+{
+    TRACKER_ENTER;
+    value += value;
+}
+
 int main()
 {
     TRACKER_DEFAULT_INITIALIZATION;
@@ -50,5 +67,8 @@ int main()
     TRACKER_CREATE(Int, origin, 0);
     auto copy = construct_from(origin);
     auto move = construct_from(std::move(origin));
+    auto named = make_named();
+    consume(std::move(copy));
+    move = std::move(named);
     TRACKER_OFF;
 }
\ No newline at end of file
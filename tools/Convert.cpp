@@ -0,0 +1,102 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    Convert.cpp
+
+Abstract:
+
+    Replays a trace written by TraceLogger through one of the
+    sinks, on any machine and long after the traced run.
+
+    Usage: tracker_convert trace.trk console|html|dot|csv|chrome|flame [--render | --copies]
+
+    --render draws the dot graph, --copies weights the flame graph
+    by copies instead of time.
+
+Author / Creation date:
+
+    JulesIMF / 01.04.22
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <Tracker.h>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <sys/stat.h>
+
+//
+// Defines
+//
+
+static Tracker::Logger* createLogger(char const* sink, char const* option)
+{
+    using namespace Tracker;
+
+    if (!strcmp(sink, "console"))
+        return new ConsoleLogger;
+
+    if (!strcmp(sink, "html"))
+        return new HtmlLogger;
+
+    if (!strcmp(sink, "csv"))
+        return new CsvLogger;
+
+    if (!strcmp(sink, "chrome"))
+        return new ChromeTraceLogger;
+
+    if (!strcmp(sink, "flame"))
+        return new FlameLogger(!strcmp(option, "--copies") ? FlameLogger::Weight::Copies : FlameLogger::Weight::Time);
+
+    if (!strcmp(sink, "dot"))
+    {
+        mkdir("dotfiles", 0755);
+        DotLogger::Options options;
+        options.render = !strcmp(option, "--render") ? DotLogger::Render::Blocking : DotLogger::Render::None;
+        return new DotLogger(options);
+    }
+
+    return nullptr;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3 || (argc > 3 && strcmp(argv[3], "--render") && strcmp(argv[3], "--copies")))
+    {
+        fprintf(stderr, "usage: %s trace.trk console|html|dot|csv|chrome|flame [--render | --copies]\n", argv[0]);
+        return 1;
+    }
+
+    try
+    {
+        Tracker::TraceReader reader(argv[1]);
+        auto logger = createLogger(argv[2], argc > 3 ? argv[3] : "");
+        if (logger == nullptr)
+        {
+            fprintf(stderr, "tracker_convert: unknown sink \"%s\"\n", argv[2]);
+            return 1;
+        }
+
+        auto nEvents = reader.replay(*logger);
+        delete logger;
+        fprintf(stderr, "tracker_convert: %zu events replayed\n", nEvents);
+    }
+
+    catch (std::exception const& error)
+    {
+        fprintf(stderr, "tracker_convert: %s\n", error.what());
+        return 1;
+    }
+
+    return 0;
+}
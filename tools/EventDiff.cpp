@@ -0,0 +1,236 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    EventDiff.cpp
+
+Abstract:
+
+    Compares event streams written by CsvLogger: copies, moves and
+    temporaries per function in every stream, with the difference
+    from the first one.
+
+    Usage: tracker_diff [name=]baseline.csv [name=]other.csv ...
+
+Author / Creation date:
+
+    JulesIMF / 29.03.22
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+//
+// Defines
+//
+
+struct Counts
+{
+    long copies = 0;
+    long moves = 0;
+    long temporaries = 0;
+};
+
+struct Stream
+{
+    std::string name;
+    std::map<std::string, Counts> functions;
+    Counts total;
+};
+
+static std::vector<std::string> splitCsv(std::string const& line)
+{
+    std::vector<std::string> fields(1);
+    bool isQuoted = false;
+    for (std::size_t i = 0; i != line.size(); i++)
+    {
+        char c = line[i];
+        if (isQuoted)
+        {
+            if (c == '"' && i + 1 != line.size() && line[i + 1] == '"')
+                fields.back() += line[++i];
+            else if (c == '"')
+                isQuoted = false;
+            else
+                fields.back() += c;
+        }
+
+        else if (c == '"')
+            isQuoted = true;
+        else if (c == ',')
+            fields.emplace_back();
+        else
+            fields.back() += c;
+    }
+
+    return fields;
+}
+
+static bool readStream(char const* argument, Stream& stream)
+{
+    std::string path = argument;
+    auto equals = path.find('=');
+    if (equals != std::string::npos)
+    {
+        stream.name = path.substr(0, equals);
+        path = path.substr(equals + 1);
+    }
+
+    else
+    {
+        stream.name = path.substr(path.find_last_of('/') + 1);
+        stream.name = stream.name.substr(0, stream.name.rfind(".csv"));
+    }
+
+    std::ifstream file(path);
+    if (!file)
+    {
+        fprintf(stderr, "tracker_diff: cant open \"%s\"\n", path.c_str());
+        return false;
+    }
+
+    //
+    // Columns: event, depth, function, object, type,
+    // temporary, source, site, bytes
+    //
+
+    std::string line;
+    std::getline(file, line);
+    while (std::getline(file, line))
+    {
+        auto fields = splitCsv(line);
+        if (fields.size() < 6)
+            continue;
+
+        auto const& event = fields[0];
+        auto function = fields[2].empty() ? std::string("(global)") : fields[2];
+        bool isCopy = event == "copy" || event == "copy=";
+        bool isMove = event == "move" || event == "move=";
+        bool isTemp = fields[5] == "1" && (event == "ctor" || event == "copy" || event == "move");
+
+        if (!isCopy && !isMove && !isTemp)
+            continue;
+
+        for (auto counts : { &stream.functions[function], &stream.total })
+        {
+            counts->copies += isCopy;
+            counts->moves += isMove;
+            counts->temporaries += isTemp;
+        }
+    }
+
+    return true;
+}
+
+static std::string cell(Counts const& counts)
+{
+    return std::to_string(counts.copies) + "/" + std::to_string(counts.moves) + "/" + std::to_string(counts.temporaries);
+}
+
+static std::string delta(long value)
+{
+    return (value > 0 ? "+" : "") + std::to_string(value);
+}
+
+static std::string cell(Counts const& counts, Counts const& baseline)
+{
+    if (counts.copies == baseline.copies && counts.moves == baseline.moves && counts.temporaries == baseline.temporaries)
+        return cell(counts);
+
+    return cell(counts) + " (" + delta(counts.copies - baseline.copies) + "/" +
+                                 delta(counts.moves - baseline.moves) + "/" +
+                                 delta(counts.temporaries - baseline.temporaries) + ")";
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || !strcmp(argv[1], "-h") || !strcmp(argv[1], "--help"))
+    {
+        fprintf(stderr, "usage: %s [name=]baseline.csv [name=]other.csv ...\n", argv[0]);
+        return argc < 2;
+    }
+
+    std::vector<Stream> streams(argc - 1);
+    for (int i = 1; i != argc; i++)
+        if (!readStream(argv[i], streams[i - 1]))
+            return 1;
+
+    //
+    // Every function seen in any stream, in name order
+    //
+
+    std::map<std::string, bool> functions;
+    for (auto const& stream : streams)
+        for (auto const& entry : stream.functions)
+            functions[entry.first] = true;
+
+    static std::size_t const maxNameWidth = 48;
+    std::size_t nameWidth = strlen("function");
+    for (auto const& entry : functions)
+        nameWidth = std::max(nameWidth, std::min(entry.first.size(), maxNameWidth));
+
+    std::vector<std::size_t> widths;
+    for (auto const& stream : streams)
+    {
+        auto width = stream.name.size();
+        for (auto const& entry : functions)
+        {
+            auto found = stream.functions.find(entry.first);
+            auto counts = found == stream.functions.end() ? Counts{} : found->second;
+            width = std::max(width, cell(counts, streams[0].functions[entry.first]).size());
+        }
+
+        widths.push_back(std::max(width, cell(stream.total, streams[0].total).size()));
+    }
+
+    auto printRow = [&](std::string name, std::vector<std::string> const& cells)
+    {
+        if (name.size() > nameWidth)
+            name = "..." + name.substr(name.size() - nameWidth + 3);
+
+        printf("%-*s", int(nameWidth), name.c_str());
+        for (std::size_t i = 0; i != cells.size(); i++)
+            printf("  %-*s", i + 1 == cells.size() ? 0 : int(widths[i]), cells[i].c_str());
+
+        printf("\n");
+    };
+
+    printf("copies/moves/temporaries per function, differences from %s in parentheses\n\n", streams[0].name.c_str());
+
+    std::vector<std::string> cells;
+    for (auto const& stream : streams)
+        cells.push_back(stream.name);
+
+    printRow("function", cells);
+
+    for (auto const& entry : functions)
+    {
+        cells.clear();
+        for (auto& stream : streams)
+            cells.push_back(cell(stream.functions[entry.first], streams[0].functions[entry.first]));
+
+        printRow(entry.first, cells);
+    }
+
+    cells.clear();
+    for (auto const& stream : streams)
+        cells.push_back(cell(stream.total, streams[0].total));
+
+    printRow("total", cells);
+    return 0;
+}